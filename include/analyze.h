@@ -0,0 +1,58 @@
+#ifndef ANALYZE_H
+#define ANALYZE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "chip8.h"
+
+// Static ROM analysis: code/data discovery by following control flow from
+// START_ADDR, basic blocks, the call graph, sprite data referenced by
+// ANNN + DXYN, and stores (FX33/FX55/5XY2) that may modify code. The
+// SUPER-CHIP and XO-CHIP instructions are understood, including the
+// four-byte F000 NNNN.
+
+#define BYTE_CODE 0x01    // first byte of a reachable instruction
+#define BYTE_OPERAND 0x02 // second byte of a reachable instruction
+#define BYTE_LEADER 0x04  // first instruction of a basic block
+#define BYTE_CALL 0x08    // 2NNN target
+#define BYTE_SPRITE 0x10  // read by DXYN with I from a known ANNN
+#define BYTE_WRITTEN 0x20 // written by FX33/FX55/5XY2 with I from a known ANNN
+#define BYTE_SMC 0x40     // code that is also written
+#define BYTE_INDIRECT 0x80 // BNNN, successors unknown
+
+#define MAX_SUCCESSORS 2
+
+typedef struct {
+    uint16_t start;
+    uint16_t end; // exclusive
+    uint16_t last; // first byte of the final instruction
+    uint16_t succ[MAX_SUCCESSORS];
+    uint8_t nsucc;
+} basic_block;
+
+typedef struct {
+    uint16_t caller;
+    uint16_t callee;
+} call_edge;
+
+typedef struct {
+    uint64_t rom_hash;
+    uint16_t rom_size;
+    uint8_t flags[RAM_SIZE];
+    basic_block* blocks;
+    int nblocks;
+    call_edge* calls;
+    int ncalls;
+} rom_analysis;
+
+rom_analysis* analyze_rom(const uint8_t*, size_t);
+rom_analysis* cached_analysis(const uint8_t*, size_t, const char*);
+void free_analysis(rom_analysis*);
+int save_analysis(const rom_analysis*, const char*);
+rom_analysis* load_analysis(const char*);
+const basic_block* find_block(const rom_analysis*, uint16_t);
+
+void disassemble(uint16_t, char*, size_t);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "chip8.h"
+
+// Buzzer audio.
+//
+// The emulation thread reports sound timer on/off edges, stamped with the
+// instruction count, into a single-producer/single-consumer ring. The
+// consumer turns them into a square wave: either the audio device callback
+// via audio_render() (no locks, no allocation) or, in headless runs,
+// audio_pump() writing a WAV file from the emulation thread.
+
+#define AUDIO_RATE 48000
+#define AUDIO_TONE 440
+#define CYCLES_PER_SECOND (TICKS_PER_FRAME * 60)
+
+typedef struct audio_state *audio;
+
+audio create_audio(int, int);
+void destroy_audio(audio);
+void attach_audio(audio, chip8);
+
+void audio_render(audio, int16_t*, int);
+
+int open_wav(audio, const char*);
+void audio_pump(audio, chip8);
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "chip8.h"
+
+// ROM catalog.
+//
+// An index file maps content hashes to paths and metadata (title, platform,
+// recommended instructions per frame, quirk profile). It is one header, an
+// array of fixed-size entries sorted by hash, and a string table, and is
+// used directly through mmap, so opening and listing a large library costs
+// no parsing. Rebuilding rehashes only files whose size or mtime changed.
+//
+// Metadata comes from the file name and extension unless a metadata file
+// overrides it, one ROM per line:
+//
+//     <hash> <platform> <speed> <quirks|-> <title...>
+
+#define CATALOG_MAGIC 0x54414338 // "8CAT"
+#define CATALOG_VERSION 1
+
+typedef enum {
+    PLATFORM_CHIP8,
+    PLATFORM_SCHIP,
+    PLATFORM_XOCHIP,
+    PLATFORM_COUNT
+} rom_platform;
+
+typedef struct {
+    uint64_t hash;
+    int64_t mtime;
+    uint32_t size;
+    uint32_t path;   // string table offsets
+    uint32_t title;
+    uint32_t quirks; // profile name, empty for the platform default
+    uint8_t platform;
+    uint8_t speed;   // instructions per frame, 0 for TICKS_PER_FRAME
+    uint16_t reserved;
+} catalog_entry;
+
+typedef struct catalog_state *catalog;
+
+const uint8_t* map_rom(const char*, size_t*);
+void unmap_rom(const uint8_t*, size_t);
+
+int build_catalog(const char*, const char*, const char*);
+catalog open_catalog(const char*);
+void close_catalog(catalog);
+
+int catalog_count(catalog);
+const catalog_entry* catalog_at(catalog, int);
+const char* catalog_string(catalog, uint32_t);
+int catalog_find(catalog, const char*, int);
+// Loads the entry's ROM and applies its speed; quirks are left to the caller.
+int load_catalog_rom(chip8, catalog, const catalog_entry*);
+
+const char* platform_name(int);
+
+#endif
@@ -5,17 +5,46 @@
 #include <stdint.h>
 #include <stddef.h>
 
-#define RAM_SIZE 4096
+// 64 KB as on XO-CHIP; CHIP-8 and SUPER-CHIP ROMs only use the first 4 KB
+#define RAM_SIZE 0x10000
+// addresses wrap around at the end of RAM
+#define ADDR_MASK (RAM_SIZE - 1)
 #define SCREEN_WIDTH 64
 #define SCREEN_HEIGHT 32
+#define HIRES_WIDTH 128
+#define HIRES_HEIGHT 64
+#define NUM_PLANES 2
+// the framebuffer is packed 1 bit per pixel, MSB of word 0 is x = 0
+#define ROW_WORDS (HIRES_WIDTH / 64)
 #define NUM_REGS 16
 #define STACK_SIZE 16
 #define NUM_KEYS 16
 
 #define START_ADDR 0x200
 
+#define TICKS_PER_FRAME 10
+
+// Faults a ROM can cause. The core never reaches outside its own state:
+// addresses wrap at the end of RAM and stack and key indices are masked to
+// their arrays, but each case raises a sticky bit so that the caller can
+// report or stop an untrusted ROM.
+#define FAULT_ADDRESS 0x01         // a memory access ran off the end of RAM
+#define FAULT_STACK_OVERFLOW 0x02  // a call with the stack full
+#define FAULT_STACK_UNDERFLOW 0x04 // a return with the stack empty
+#define FAULT_KEY 0x08             // EX9E/EXA1 with VX above F
+#define FAULT_OPCODE 0x10          // an unknown instruction, ignored
+// `fault` if `cond` holds, else 0, without a branch
+#define FAULT_MASK(cond, fault) ((uint8_t)(-(int)(cond) & (fault)))
+
+// A coverage bitmap has one bit per address, bit N % 8 of byte N / 8.
+#define COVERAGE_BYTES (RAM_SIZE / 8)
+
 #define FONTSET_SIZE 80
 extern const uint8_t FONTSET[FONTSET_SIZE];
+// SUPER-CHIP 8x10 digits, placed right after the small font
+#define BIGFONT_ADDR FONTSET_SIZE
+#define BIGFONT_SIZE 160
+extern const uint8_t BIGFONT[BIGFONT_SIZE];
 //     0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
 //     0x20, 0x60, 0x20, 0x20, 0x70, // 1
 //     0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
@@ -35,19 +64,37 @@ extern const uint8_t FONTSET[FONTSET_SIZE];
 // };
 
 typedef struct chip8emu *chip8; 
+struct engine;
+
+// Called when the buzzer turns on or off, with the instruction count at
+// which it happened.
+typedef void (*buzzer_fn)(void*, bool, uint64_t);
 
 chip8 init_emulator(void);
 void destroy_emulator(chip8);
+chip8 clone_emulator(chip8);
+void copy_emulator(chip8, chip8);
+uint64_t hash_state(chip8);
 
 uint16_t get_pc(chip8);
 void set_pc(chip8, uint16_t);
 
 uint8_t get_ram(chip8, int);
-uint8_t* get_ram_ptr(chip8, int);
+const uint8_t* get_ram_ptr(chip8, int);
 void set_ram(chip8, uint8_t, int);
+void set_ram_range(chip8, const uint8_t*, int, size_t);
+void invalidate_code(chip8, int, int);
 
-bool get_screen(chip8, int);
-void set_screen(chip8, bool, int);
+uint64_t* get_plane(chip8, int);
+bool get_hires(chip8);
+void set_hires(chip8, bool);
+uint8_t get_planes(chip8);
+void set_planes(chip8, uint8_t);
+int screen_width(chip8);
+int screen_height(chip8);
+
+uint8_t get_rpl(chip8, int);
+void set_rpl(chip8, uint8_t, int);
 
 uint8_t get_vreg(chip8, int);
 void set_vreg(chip8, uint8_t, int);
@@ -70,7 +117,34 @@ void set_dt(chip8, uint8_t);
 uint8_t get_st(chip8);
 void set_st(chip8, uint8_t);
 
-bool* get_display(chip8);
+bool get_trace(chip8);
+void set_trace(chip8, bool);
+
+uint32_t get_rng(chip8);
+void set_rng(chip8, uint32_t);
+
+const struct engine* get_engine(chip8);
+void set_engine(chip8, const struct engine*);
+
+uint64_t get_cycles(chip8);
+void set_cycles(chip8, uint64_t);
+
+uint64_t get_draws(chip8);
+void set_draws(chip8, uint64_t);
+
+int get_speed(chip8);
+void set_speed(chip8, int);
+
+uint8_t get_faults(chip8);
+void set_faults(chip8, uint8_t);
+void raise_fault(chip8, uint8_t);
+const char* fault_name(uint8_t);
+
+uint8_t* get_coverage(chip8);
+void set_coverage(chip8, uint8_t*);
+
+void set_buzzer(chip8, buzzer_fn, void*);
+void sound_edge(chip8, bool);
 // void keypress(chip8, uint16_t, bool);
 // void load(chip8, uint8_t*, size_t);
 //
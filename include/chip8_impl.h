@@ -0,0 +1,69 @@
+#ifndef CHIP8_IMPL_H
+#define CHIP8_IMPL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "chip8.h"
+#include "hash.h"
+
+// The emulator state. Everything outside chip8.c goes through the accessors
+// in chip8.h; only the specialised interpreters in quirks.c read it directly.
+
+// Superinstructions recognised by the fused interpreters (src/interp.inc),
+// cached per address in `fused`. Operands are read from RAM when run, so a
+// cached kind only depends on the instruction forms.
+enum {
+    FUSED_UNKNOWN,   // not decoded yet
+    FUSED_NONE,
+    FUSED_JUMP_SELF, // 1NNN to itself, an idle loop
+    FUSED_LOAD_DRAW, // ANNN; DXYN
+    FUSED_LOAD_LOAD, // 6XNN; 6YNN
+    FUSED_LOOP,      // FX07 or 7XNN; 3XNN or 4XNN; 1NNN
+};
+
+// the longest superinstruction, in instructions and bytes
+#define FUSED_MAX 3
+
+// Raises `fault` when `cond` holds, without a branch.
+#define FAULT_IF(emu, cond, fault) ((emu)->faults |= FAULT_MASK(cond, fault))
+
+struct chip8emu {
+    uint16_t pc;
+    uint8_t ram[RAM_SIZE];
+    uint64_t screen[NUM_PLANES][HIRES_HEIGHT][ROW_WORDS];
+    bool hires;
+    uint8_t planes; // XO-CHIP plane mask, bit N selects plane N
+    uint8_t flags[NUM_REGS]; // SUPER-CHIP RPL user flags
+    uint8_t v_reg[NUM_REGS];
+    uint16_t i_reg;
+    uint16_t sp;
+    uint16_t stack[STACK_SIZE];
+    bool keys[NUM_KEYS];
+    uint8_t dt;
+    uint8_t st;
+    bool trace;
+    uint32_t rng;
+    const struct engine* engine;
+    uint64_t cycles;
+    uint64_t draws;
+    uint64_t ram_sum; // RAM_TERM summed over RAM, kept by STORE_RAM
+    int speed; // instructions per frame
+    uint8_t faults;
+    uint8_t* coverage; // PCs run by tick(), not owned, or NULL
+    buzzer_fn buzzer;
+    void* buzzer_ctx;
+    uint8_t fused[RAM_SIZE];
+};
+
+// hash_state() covers RAM through a sum of one mixed term per nonzero
+// byte, so a store adjusts it in constant time instead of RAM being
+// rehashed at every comparison. Every write to ram[] goes through here.
+#define RAM_TERM(addr, value) ((value) ? mix64((uint64_t)(addr) << 8 | (value)) : 0)
+#define STORE_RAM(emu, addr, value) do { \
+        uint16_t at_ = (addr); \
+        uint8_t byte_ = (value); \
+        (emu)->ram_sum += RAM_TERM(at_, byte_) - RAM_TERM(at_, (emu)->ram[at_]); \
+        (emu)->ram[at_] = byte_; \
+    } while (0)
+
+#endif
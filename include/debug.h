@@ -0,0 +1,37 @@
+#ifndef DEBUG_H
+#define DEBUG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "chip8.h"
+
+// Interactive debugger.
+//
+// Breakpoints live in a byte-per-address map and watchpoints are flagged per
+// 256-byte page, so the debug loop pays one byte test per instruction (plus a
+// page test on memory opcodes while watches exist). While nothing is set the
+// frontend keeps calling run_frame() and the debugger costs nothing.
+
+#define WATCH_READ 1
+#define WATCH_WRITE 2
+
+typedef struct debugger_state *debugger;
+
+debugger create_debugger(void);
+void destroy_debugger(debugger);
+
+void add_breakpoint(debugger, uint16_t);
+int add_conditional_breakpoint(debugger, uint16_t, const char*);
+void remove_breakpoint(debugger, uint16_t);
+int add_watchpoint(debugger, uint16_t, uint16_t, int);
+void remove_watchpoint(debugger, uint16_t);
+
+bool debug_armed(debugger);
+bool debug_paused(debugger);
+void debug_break(debugger);
+bool debug_frame(debugger, chip8);
+bool debug_repl(debugger, chip8, FILE*);
+
+#endif
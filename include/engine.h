@@ -0,0 +1,26 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "chip8.h"
+
+// An execution engine runs up to `budget` instructions and returns how many
+// it actually executed. "reference" is tick() from helpers.c; every other
+// engine must stay state-for-state identical to it, which is what the
+// lockstep tool checks.
+
+// The flags describe what an instruction touches, for tools such as the
+// debugger's watchpoints; they have to match the profile in quirks.c.
+struct engine {
+    const char* name;
+    int (*run)(chip8, int);
+    bool memory_short; // FX55/FX65 stop before VX
+    bool big_sprites;  // DXY0 draws a 16x16 sprite
+};
+
+const struct engine* default_engine(void);
+const struct engine* find_engine(const char*);
+void list_engines(FILE*);
+
+#endif
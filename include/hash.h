@@ -0,0 +1,10 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+uint64_t hash64(const void*, size_t, uint64_t);
+uint64_t mix64(uint64_t);
+
+#endif
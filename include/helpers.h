@@ -4,10 +4,26 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <stdio.h>
 #include "chip8.h"
 
+// A copy of the framebuffer for output stages: both planes, full hi-res
+// size, MSB of word 0 is x = 0. In lo-res only word 0 of the first 32 rows
+// is used.
+#define SCREEN_HIRES 0x01
+#define SCREEN_PLANE2 0x02 // the second plane has something on it
+
+typedef struct {
+    uint8_t mode;
+    uint64_t rows[NUM_PLANES][HIRES_HEIGHT][ROW_WORDS];
+} packed_screen;
+
+#define PACKED_WIDTH(s) ((s)->mode & SCREEN_HIRES ? HIRES_WIDTH : SCREEN_WIDTH)
+#define PACKED_HEIGHT(s) ((s)->mode & SCREEN_HIRES ? HIRES_HEIGHT : SCREEN_HEIGHT)
+
 void keypress(chip8, uint16_t, bool);
-void load(chip8, uint8_t*, size_t);
+void load(chip8, const uint8_t*, size_t);
+int load_rom(chip8, const char*);
 
 void reset(chip8);
 
@@ -15,6 +31,11 @@ void stack_push(chip8, uint16_t);
 uint16_t stack_pop(chip8);
 
 void tick(chip8);
+void run_frame(chip8);
+uint8_t random_byte(chip8);
+void pack_screen(chip8, packed_screen*);
+uint64_t hash_screen(chip8);
+void dump_state(chip8, FILE*);
 uint16_t fetch(chip8);
 void tick_timer(chip8);
 void execute_draw(chip8, uint8_t, uint8_t, uint8_t);
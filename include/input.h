@@ -0,0 +1,27 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "chip8.h"
+
+// Sub-frame key input for a frontend that emulates a burst of frames per
+// display frame.
+//
+// The frontend splits each burst into slices spread over the display frame
+// and polls for key events before every slice. run_queued() applies what
+// was polled, then runs the slice, so an event takes effect within a slice
+// of happening rather than at the next frame. A press released before the
+// next poll still gets one instruction, so short taps register.
+
+typedef struct input_queue_state *input_queue;
+
+input_queue create_input_queue(void);
+void destroy_input_queue(input_queue);
+
+void queue_key(input_queue, uint8_t, bool);
+void run_queued(chip8, input_queue, int*, int);
+void flush_queued(chip8, input_queue);
+
+#endif
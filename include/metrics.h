@@ -0,0 +1,48 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "chip8.h"
+
+// Runtime instrumentation.
+//
+// Each emulator instance owns one `metrics`, updated only by the thread that
+// runs it: a handful of counters plus a log-linear latency histogram per
+// frame phase (8 sub-buckets per power of two, so quantiles are within
+// about 6%). Writes are plain relaxed stores, so a server on another thread
+// can read without locking. metrics_mark() costs one clock read; the
+// frontend makes four per frame.
+//
+// The server answers HTTP on a Unix or TCP address (see net.h):
+// GET /metrics is Prometheus text, GET /json the same data as JSON.
+
+typedef enum {
+    PHASE_POLL,
+    PHASE_TICK,
+    PHASE_DRAW,
+    PHASE_IDLE,
+    PHASE_COUNT
+} metrics_phase;
+
+typedef struct metrics_state *metrics;
+typedef struct metrics_server_state *metrics_server;
+
+metrics create_metrics(const char*);
+void destroy_metrics(metrics);
+void set_metrics_dump(metrics, const char*);
+
+void metrics_mark(metrics, metrics_phase);
+void metrics_frame(metrics, chip8);
+
+void write_prometheus(metrics*, int, FILE*);
+void write_json(metrics*, int, FILE*);
+
+metrics_server create_metrics_server(const char*);
+void destroy_metrics_server(metrics_server);
+void register_metrics(metrics_server, metrics);
+void metrics_serve(metrics_server);
+
+#endif
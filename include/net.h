@@ -0,0 +1,14 @@
+#ifndef NET_H
+#define NET_H
+
+#include <stdbool.h>
+
+// Socket helpers shared by the frame stream and the metrics endpoint.
+// Addresses are "unix:/path/to/socket" or "[host:]port" (host defaults to
+// 127.0.0.1). Servers get a listening socket and, for Unix sockets, the path
+// to unlink when done.
+
+int set_nonblocking(int);
+int open_socket(const char*, bool, char*);
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef QUIRKS_H
+#define QUIRKS_H
+
+#include "chip8.h"
+
+// Interpreters specialised at compile time for each quirk profile (see
+// src/interp.inc). They are registered as engines under the profile name.
+
+int run_quirks_legacy(chip8, int);
+int run_quirks_fused(chip8, int);
+int run_quirks_vip(chip8, int);
+int run_quirks_chip48(chip8, int);
+int run_quirks_schip(chip8, int);
+int run_quirks_xochip(chip8, int);
+
+#endif
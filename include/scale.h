@@ -0,0 +1,32 @@
+#ifndef SCALE_H
+#define SCALE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "chip8.h"
+
+// Software output stage: 1-bit framebuffer -> ARGB8888 pixels, optionally
+// through a pixel-art scaling filter and with phosphor persistence. The
+// output is 64x32 or 128x64 times the filter scale, following the ROM.
+
+typedef enum {
+    FILTER_NONE,
+    FILTER_SCALE2X, // also known as EPX
+    FILTER_SCALE3X,
+} scale_filter;
+
+#define MAX_FILTER_SCALE 3
+
+typedef struct scaler_state *scaler;
+
+scaler create_scaler(scale_filter, uint8_t, uint32_t, uint32_t);
+void destroy_scaler(scaler);
+
+int scaler_width(scaler);
+int scaler_height(scaler);
+const uint32_t* scale_frame(scaler, chip8);
+
+int parse_filter(const char*, scale_filter*);
+
+#endif
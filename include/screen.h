@@ -0,0 +1,21 @@
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "chip8.h"
+
+// Framebuffer operations shared by every interpreter. The planes are packed
+// 1 bit per pixel, so scrolling is a row move or a word shift rather than a
+// loop over pixels. Only the planes selected with FN01 are touched.
+// xor_row() draws one sprite row and reports a collision.
+
+bool xor_row(uint64_t*, uint16_t, int, int, bool);
+void clear_screen(chip8);
+void set_resolution(chip8, bool);
+void scroll_down(chip8, int);
+void scroll_up(chip8, int);
+void scroll_right(chip8);
+void scroll_left(chip8);
+
+#endif
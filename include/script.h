@@ -0,0 +1,28 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "chip8.h"
+
+// Scripted key input, one event per line: "<frame> <key> <0|1>".
+// Events for frame N are applied before frame N runs.
+
+typedef struct {
+    uint32_t frame;
+    uint8_t key;
+    bool pressed;
+} input_event;
+
+typedef struct {
+    input_event* events;
+    int count;
+} input_script;
+
+int load_script(const char*, input_script*);
+int save_script(const char*, const input_script*);
+void free_script(input_script*);
+int apply_script(chip8, const input_script*, int, uint32_t);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef SHM_H
+#define SHM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "chip8.h"
+
+// Live framebuffer export over POSIX shared memory.
+//
+// The segment holds one shared_frame guarded by a seqlock: the writer makes
+// `seq` odd while it updates the frame and even again when done, so a reader
+// copies the frame and retries if `seq` was odd or changed meanwhile. The
+// emulator side never blocks and never makes a syscall per frame.
+
+#define SHARED_FRAME_MAGIC 0x38504843u // "CHP8"
+#define SHARED_FRAME_VERSION 2
+
+struct shared_frame {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seq;
+    uint16_t width;
+    uint16_t height;
+    uint64_t frame;
+    uint16_t keys; // bit N set while key N is held
+    uint8_t mode;  // SCREEN_HIRES, SCREEN_PLANE2 (helpers.h)
+    // MSB of word 0 is x = 0; `width` x `height` of each plane is valid
+    uint64_t rows[NUM_PLANES][HIRES_HEIGHT][ROW_WORDS];
+};
+
+typedef struct shm_publisher_state *shm_publisher;
+
+shm_publisher create_publisher(const char*);
+void destroy_publisher(shm_publisher);
+void publish_frame(shm_publisher, chip8, uint64_t);
+
+struct shared_frame* map_shared_frame(const char*);
+void unmap_shared_frame(struct shared_frame*);
+void read_shared_frame(const struct shared_frame*, struct shared_frame*);
+
+#endif
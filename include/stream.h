@@ -0,0 +1,47 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "chip8.h"
+#include "helpers.h"
+
+// Delta-compressed framebuffer streaming over a Unix or TCP socket.
+//
+// Addresses are "unix:/path/to/socket" or "[host:]port" (host defaults to
+// 127.0.0.1). Server to client, one message per frame:
+//
+//     'K' or 'D'  keyframe (every row) or delta (changed rows only)
+//     u32 LE      frame number
+//     u8          screen mode, SCREEN_HIRES | SCREEN_PLANE2 (helpers.h)
+//     u8          number of rows that follow
+//     per row:    u8 plane << 7 | y, u8 encoded length, (u8 run, u8 byte) pairs
+//
+// A row is its width / 8 bytes, MSB first, run-length encoded by byte, so
+// an unchanged frame is 7 bytes. A keyframe starts from a blank screen and
+// leaves out the second plane when it is empty; a mode change always sends
+// one. Client to server, one byte per key event: bit 7 set for press, low
+// nibble the key.
+
+#define STREAM_KEYFRAME_INTERVAL 300
+#define STREAM_ROW_BYTES (HIRES_WIDTH / 8)
+#define STREAM_MAX_MESSAGE (7 + NUM_PLANES * HIRES_HEIGHT * (2 + 2 * STREAM_ROW_BYTES))
+
+typedef struct stream_server_state *stream_server;
+typedef struct stream_client_state *stream_client;
+
+stream_server create_stream_server(const char*);
+void destroy_stream_server(stream_server);
+int stream_poll(stream_server, chip8);
+void stream_frame(stream_server, chip8, uint32_t);
+
+size_t encode_frame(const packed_screen*, const packed_screen*, uint32_t, uint8_t*);
+
+stream_client connect_stream(const char*);
+void destroy_stream_client(stream_client);
+int stream_client_fd(stream_client);
+int stream_receive(stream_client, packed_screen*, uint32_t*);
+int stream_send_key(stream_client, uint8_t, bool);
+
+#endif
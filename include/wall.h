@@ -0,0 +1,36 @@
+#ifndef WALL_H
+#define WALL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "chip8.h"
+
+// Video wall: many emulators tiled into one ARGB8888 atlas.
+//
+// Every instance gets a 128x64 tile (lo-res pixels are doubled) in a grid.
+// wall_render() compares each tile's planes with what the atlas already
+// shows and repaints only the rows that changed, marking them in a dirty
+// row map. wall_dirty() walks that map as runs of rows, so a frontend
+// uploads each changed band with one texture update and draws the whole
+// wall with a single copy. The wall does not own the emulators.
+
+#define WALL_TILE_WIDTH HIRES_WIDTH
+#define WALL_TILE_HEIGHT HIRES_HEIGHT
+
+typedef struct wall_state *wall;
+
+wall create_wall(chip8*, int, int);
+void destroy_wall(wall);
+
+int wall_width(wall);
+int wall_height(wall);
+const uint32_t* wall_pixels(wall);
+
+int wall_render(wall);
+int wall_dirty(wall, int, int*);
+
+int wall_tile_at(wall, int, int);
+void wall_tile_origin(wall, int, int*, int*);
+
+#endif
@@ -0,0 +1,476 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/analyze.h"
+#include "../include/hash.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define ANALYSIS_MAGIC 0x4E413843u // "C8AN"
+#define ANALYSIS_VERSION 3
+
+typedef struct {
+    uint16_t start;
+    uint16_t len;
+} write_range;
+
+typedef struct {
+    uint16_t* items;
+    int count;
+    int cap;
+} worklist;
+
+static void push(worklist* w, uint16_t addr) {
+    if (w->count == w->cap) {
+        w->cap = w->cap ? w->cap * 2 : 64;
+        w->items = realloc(w->items, w->cap * sizeof(uint16_t));
+    }
+    w->items[w->count++] = addr;
+}
+
+static void* grow(void* items, int count, int* cap, size_t size) {
+    if (count < *cap) {
+        return items;
+    }
+    *cap = *cap ? *cap * 2 : 64;
+    return realloc(items, (size_t)*cap * size);
+}
+
+static rom_analysis* new_analysis(void) {
+    rom_analysis* a = (rom_analysis*)calloc(1, sizeof(rom_analysis));
+    if (!a) {
+        fprintf(stderr, "Failed to allocate memory for analysis\n");
+        exit(EXIT_FAILURE);
+    }
+    return a;
+}
+
+static bool is_skip(uint16_t op) {
+    switch (op >> 12) {
+        case 0x3: case 0x4: case 0x9: return true;
+        case 0x5: return (op & 0xF) == 0;
+        case 0xE: return (op & 0xFF) == 0x9E || (op & 0xFF) == 0xA1;
+        default: return false;
+    }
+}
+
+// 00E0 and the SUPER-CHIP/XO-CHIP scroll and resolution instructions.
+static bool is_display(uint16_t op) {
+    return op == 0x00E0 || (op & 0xFFE0) == 0x00C0 || op == 0x00FB || op == 0x00FC
+        || op == 0x00FE || op == 0x00FF;
+}
+
+// Whether the instruction ends a basic block.
+static bool ends_block(uint16_t op) {
+    switch (op >> 12) {
+        case 0x0: return !is_display(op);
+        case 0x1: case 0x2: case 0xB: return true;
+        default: return is_skip(op);
+    }
+}
+
+// Instruction length at `addr`: XO-CHIP's F000 NNNN takes four bytes.
+static int op_size(const uint8_t* rom, uint32_t addr, uint32_t end) {
+    return addr + 3 < end && rom[addr - START_ADDR] == 0xF0 && rom[addr + 1 - START_ADDR] == 0x00 ? 4 : 2;
+}
+
+static void mark(rom_analysis* a, uint16_t start, uint16_t len, uint8_t flag) {
+    for (uint32_t i = start; i < (uint32_t)start + len && i < RAM_SIZE; i++) {
+        a->flags[i] |= flag;
+    }
+}
+
+// Follows control flow from every address on the worklist, marking code and
+// recording everything that needs the whole picture for a second pass.
+static void discover(rom_analysis* a, const uint8_t* rom, worklist* work,
+                     write_range** writes, int* nwrites, int* writes_cap) {
+    uint32_t end = START_ADDR + a->rom_size;
+    int calls_cap = 0;
+
+    while (work->count > 0) {
+        uint16_t addr = work->items[--work->count];
+        int known_i = -1;
+
+        while (addr >= START_ADDR && (uint32_t)addr + 1 < end && !(a->flags[addr] & BYTE_CODE)) {
+            uint16_t op = rom[addr - START_ADDR] << 8 | rom[addr + 1 - START_ADDR];
+            uint8_t x = (op >> 8) & 0xF;
+            uint16_t nnn = op & 0x0FFF;
+            a->flags[addr] |= BYTE_CODE;
+            a->flags[addr + 1] |= BYTE_OPERAND;
+
+            if (is_skip(op)) {
+                uint16_t target = addr + 2 + op_size(rom, addr + 2, end);
+                a->flags[(uint16_t)(addr + 2)] |= BYTE_LEADER;
+                a->flags[target] |= BYTE_LEADER;
+                push(work, target);
+                addr += 2;
+                continue;
+            }
+
+            switch (op >> 12) {
+                case 0x0:
+                    if (!is_display(op)) {
+                        addr = end;
+                        continue;
+                    }
+                    break;
+                case 0x1:
+                    a->flags[nnn] |= BYTE_LEADER;
+                    push(work, nnn);
+                    addr = end;
+                    continue;
+                case 0x2:
+                    a->flags[nnn] |= BYTE_LEADER | BYTE_CALL;
+                    a->flags[(uint16_t)(addr + 2)] |= BYTE_LEADER;
+                    a->calls = grow(a->calls, a->ncalls, &calls_cap, sizeof(call_edge));
+                    a->calls[a->ncalls].caller = addr;
+                    a->calls[a->ncalls].callee = nnn;
+                    a->ncalls++;
+                    push(work, nnn);
+                    // the callee may change I
+                    known_i = -1;
+                    break;
+                case 0xA:
+                    known_i = nnn;
+                    break;
+                case 0xB:
+                    a->flags[addr] |= BYTE_INDIRECT;
+                    addr = end;
+                    continue;
+                case 0x5:
+                    if ((op & 0xF) == 0x2 && known_i >= 0) {
+                        uint8_t y = (op >> 4) & 0xF;
+                        *writes = grow(*writes, *nwrites, writes_cap, sizeof(write_range));
+                        (*writes)[*nwrites].start = (uint16_t)known_i;
+                        (*writes)[*nwrites].len = (x > y ? x - y : y - x) + 1;
+                        (*nwrites)++;
+                    }
+                    break;
+                case 0xD:
+                    if (known_i >= 0) {
+                        // DXY0 is a 16x16 sprite
+                        mark(a, (uint16_t)known_i, op & 0xF ? op & 0xF : 32, BYTE_SPRITE);
+                    }
+                    break;
+                case 0xF:
+                    if (op == 0xF000 && op_size(rom, addr, end) == 4) {
+                        known_i = rom[addr + 2 - START_ADDR] << 8 | rom[addr + 3 - START_ADDR];
+                        a->flags[addr + 2] |= BYTE_OPERAND;
+                        a->flags[addr + 3] |= BYTE_OPERAND;
+                        addr += 2;
+                    } else if ((op & 0xFF) == 0x33 || (op & 0xFF) == 0x55) {
+                        if (known_i >= 0) {
+                            *writes = grow(*writes, *nwrites, writes_cap, sizeof(write_range));
+                            (*writes)[*nwrites].start = (uint16_t)known_i;
+                            (*writes)[*nwrites].len = (op & 0xFF) == 0x33 ? 3 : x + 1;
+                            (*nwrites)++;
+                        }
+                    } else if ((op & 0xFF) == 0x1E || (op & 0xFF) == 0x29 || (op & 0xFF) == 0x30) {
+                        known_i = -1;
+                    }
+                    break;
+                default:
+                    break;
+            }
+            addr += 2;
+        }
+    }
+}
+
+static void build_blocks(rom_analysis* a, const uint8_t* rom) {
+    uint32_t end = START_ADDR + a->rom_size;
+    int cap = 0;
+    uint32_t addr = START_ADDR;
+
+    while (addr + 1 < end) {
+        if (!(a->flags[addr] & BYTE_CODE)) {
+            addr++;
+            continue;
+        }
+
+        a->blocks = grow(a->blocks, a->nblocks, &cap, sizeof(basic_block));
+        basic_block* b = &a->blocks[a->nblocks++];
+        b->start = (uint16_t)addr;
+        b->nsucc = 0;
+        a->flags[addr] |= BYTE_LEADER;
+
+        for (;;) {
+            b->last = (uint16_t)addr;
+            uint16_t op = rom[addr - START_ADDR] << 8 | rom[addr + 1 - START_ADDR];
+            addr += op == 0xF000 ? op_size(rom, addr, end) : 2;
+            if (ends_block(op) || addr + 1 >= end || !(a->flags[addr] & BYTE_CODE)
+                    || (a->flags[addr] & BYTE_LEADER)) {
+                break;
+            }
+        }
+        b->end = (uint16_t)addr;
+    }
+}
+
+static void link_blocks(rom_analysis* a, const uint8_t* rom) {
+    uint32_t end = START_ADDR + a->rom_size;
+    for (int i = 0; i < a->nblocks; i++) {
+        basic_block* b = &a->blocks[i];
+        uint16_t op = rom[b->last - START_ADDR] << 8 | rom[b->last + 1 - START_ADDR];
+        b->nsucc = 0;
+        if (is_skip(op)) {
+            b->succ[b->nsucc++] = b->end;
+            b->succ[b->nsucc++] = b->end + op_size(rom, b->end, end);
+        } else if (op >> 12 == 0x1) {
+            b->succ[b->nsucc++] = op & 0x0FFF;
+        } else if (op >> 12 == 0x2 || !ends_block(op)) {
+            // calls return to the next instruction; anything else falls through
+            if (a->flags[b->end] & BYTE_CODE) {
+                b->succ[b->nsucc++] = b->end;
+            }
+        }
+    }
+}
+
+rom_analysis* analyze_rom(const uint8_t* rom, size_t size) {
+    rom_analysis* a = new_analysis();
+    if (size > RAM_SIZE - START_ADDR) {
+        size = RAM_SIZE - START_ADDR;
+    }
+    a->rom_hash = hash64(rom, size, 0);
+    a->rom_size = (uint16_t)size;
+
+    worklist work = { NULL, 0, 0 };
+    write_range* writes = NULL;
+    int nwrites = 0;
+    int writes_cap = 0;
+
+    a->flags[START_ADDR] |= BYTE_LEADER;
+    push(&work, START_ADDR);
+    discover(a, rom, &work, &writes, &nwrites, &writes_cap);
+    free(work.items);
+
+    for (int i = 0; i < nwrites; i++) {
+        mark(a, writes[i].start, writes[i].len, BYTE_WRITTEN);
+    }
+    free(writes);
+    for (int i = 0; i < RAM_SIZE; i++) {
+        if ((a->flags[i] & BYTE_WRITTEN) && (a->flags[i] & (BYTE_CODE | BYTE_OPERAND))) {
+            a->flags[i] |= BYTE_SMC;
+        }
+    }
+
+    build_blocks(a, rom);
+    link_blocks(a, rom);
+    return a;
+}
+
+void free_analysis(rom_analysis* a) {
+    free(a->blocks);
+    free(a->calls);
+    free(a);
+}
+
+const basic_block* find_block(const rom_analysis* a, uint16_t addr) {
+    int lo = 0;
+    int hi = a->nblocks - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (addr < a->blocks[mid].start) {
+            hi = mid - 1;
+        } else if (addr >= a->blocks[mid].end) {
+            lo = mid + 1;
+        } else {
+            return &a->blocks[mid];
+        }
+    }
+    return NULL;
+}
+
+int save_analysis(const rom_analysis* a, const char* path) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    uint32_t header[2] = { ANALYSIS_MAGIC, ANALYSIS_VERSION };
+    bool ok = fwrite(header, sizeof(header), 1, f) == 1
+        && fwrite(&a->rom_hash, sizeof(a->rom_hash), 1, f) == 1
+        && fwrite(&a->rom_size, sizeof(a->rom_size), 1, f) == 1
+        && fwrite(a->flags, sizeof(a->flags), 1, f) == 1
+        && fwrite(&a->nblocks, sizeof(a->nblocks), 1, f) == 1
+        && fwrite(a->blocks, sizeof(basic_block), a->nblocks, f) == (size_t)a->nblocks
+        && fwrite(&a->ncalls, sizeof(a->ncalls), 1, f) == 1
+        && fwrite(a->calls, sizeof(call_edge), a->ncalls, f) == (size_t)a->ncalls;
+    if (fclose(f) != 0 || !ok) {
+        fprintf(stderr, "%s: write failed\n", path);
+        remove(path);
+        return -1;
+    }
+    return 0;
+}
+
+rom_analysis* load_analysis(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    rom_analysis* a = new_analysis();
+    uint32_t header[2];
+    bool ok = fread(header, sizeof(header), 1, f) == 1
+        && header[0] == ANALYSIS_MAGIC && header[1] == ANALYSIS_VERSION
+        && fread(&a->rom_hash, sizeof(a->rom_hash), 1, f) == 1
+        && fread(&a->rom_size, sizeof(a->rom_size), 1, f) == 1
+        && fread(a->flags, sizeof(a->flags), 1, f) == 1
+        && fread(&a->nblocks, sizeof(a->nblocks), 1, f) == 1
+        && a->nblocks >= 0 && a->nblocks <= RAM_SIZE;
+    if (ok) {
+        a->blocks = malloc(sizeof(basic_block) * (a->nblocks ? a->nblocks : 1));
+        ok = fread(a->blocks, sizeof(basic_block), a->nblocks, f) == (size_t)a->nblocks
+            && fread(&a->ncalls, sizeof(a->ncalls), 1, f) == 1
+            && a->ncalls >= 0 && a->ncalls <= RAM_SIZE;
+    }
+    if (ok) {
+        a->calls = malloc(sizeof(call_edge) * (a->ncalls ? a->ncalls : 1));
+        ok = fread(a->calls, sizeof(call_edge), a->ncalls, f) == (size_t)a->ncalls;
+    }
+    fclose(f);
+    if (!ok) {
+        free_analysis(a);
+        return NULL;
+    }
+    return a;
+}
+
+// Loads the analysis for `rom` from `dir`, keyed by content hash, or runs
+// and stores it there if it is missing or stale.
+rom_analysis* cached_analysis(const uint8_t* rom, size_t size, const char* dir) {
+    if (size > RAM_SIZE - START_ADDR) {
+        size = RAM_SIZE - START_ADDR;
+    }
+    uint64_t h = hash64(rom, size, 0);
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%016llX.c8a", dir, (unsigned long long)h);
+
+    rom_analysis* a = load_analysis(path);
+    if (a && a->rom_hash == h && a->rom_size == size) {
+        return a;
+    }
+    if (a) {
+        free_analysis(a);
+    }
+
+    a = analyze_rom(rom, size);
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        perror(dir);
+    } else {
+        save_analysis(a, path);
+    }
+    return a;
+}
+
+void disassemble(uint16_t op, char* buf, size_t len) {
+    uint8_t x = (op >> 8) & 0xF;
+    uint8_t y = (op >> 4) & 0xF;
+    uint8_t n = op & 0xF;
+    uint8_t nn = op & 0xFF;
+    uint16_t nnn = op & 0x0FFF;
+
+    switch (op >> 12) {
+        case 0x0:
+            if (op == 0x00E0) {
+                snprintf(buf, len, "CLS");
+            } else if (op == 0x00EE) {
+                snprintf(buf, len, "RET");
+            } else if ((op & 0xFFF0) == 0x00C0) {
+                snprintf(buf, len, "SCD %X", n);
+            } else if ((op & 0xFFF0) == 0x00D0) {
+                snprintf(buf, len, "SCU %X", n);
+            } else if (op == 0x00FB) {
+                snprintf(buf, len, "SCR");
+            } else if (op == 0x00FC) {
+                snprintf(buf, len, "SCL");
+            } else if (op == 0x00FD) {
+                snprintf(buf, len, "EXIT");
+            } else if (op == 0x00FE) {
+                snprintf(buf, len, "LOW");
+            } else if (op == 0x00FF) {
+                snprintf(buf, len, "HIGH");
+            } else {
+                snprintf(buf, len, "SYS %03X", nnn);
+            }
+            return;
+        case 0x1: snprintf(buf, len, "JP %03X", nnn); return;
+        case 0x2: snprintf(buf, len, "CALL %03X", nnn); return;
+        case 0x3: snprintf(buf, len, "SE V%X, %02X", x, nn); return;
+        case 0x4: snprintf(buf, len, "SNE V%X, %02X", x, nn); return;
+        case 0x5:
+            if (n == 0) {
+                snprintf(buf, len, "SE V%X, V%X", x, y);
+                return;
+            } else if (n == 2) {
+                snprintf(buf, len, "SAVE V%X-V%X", x, y);
+                return;
+            } else if (n == 3) {
+                snprintf(buf, len, "LOAD V%X-V%X", x, y);
+                return;
+            }
+            break;
+        case 0x6: snprintf(buf, len, "LD V%X, %02X", x, nn); return;
+        case 0x7: snprintf(buf, len, "ADD V%X, %02X", x, nn); return;
+        case 0x8: {
+            static const char* ALU[16] = {
+                "LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN",
+                NULL, NULL, NULL, NULL, NULL, NULL, "SHL", NULL,
+            };
+            if (ALU[n]) {
+                snprintf(buf, len, "%s V%X, V%X", ALU[n], x, y);
+                return;
+            }
+            break;
+        }
+        case 0x9:
+            if (n == 0) {
+                snprintf(buf, len, "SNE V%X, V%X", x, y);
+                return;
+            }
+            break;
+        case 0xA: snprintf(buf, len, "LD I, %03X", nnn); return;
+        case 0xB: snprintf(buf, len, "JP V0, %03X", nnn); return;
+        case 0xC: snprintf(buf, len, "RND V%X, %02X", x, nn); return;
+        case 0xD: snprintf(buf, len, "DRW V%X, V%X, %X", x, y, n); return;
+        case 0xE:
+            if (nn == 0x9E) {
+                snprintf(buf, len, "SKP V%X", x);
+                return;
+            } else if (nn == 0xA1) {
+                snprintf(buf, len, "SKNP V%X", x);
+                return;
+            }
+            break;
+        case 0xF:
+            if (op == 0xF000) {
+                // the address is in the next word
+                snprintf(buf, len, "LD I, LONG");
+                return;
+            } else if (op == 0xF002) {
+                snprintf(buf, len, "AUDIO");
+                return;
+            }
+            switch (nn) {
+                case 0x01: snprintf(buf, len, "PLANE %X", x); return;
+                case 0x07: snprintf(buf, len, "LD V%X, DT", x); return;
+                case 0x0A: snprintf(buf, len, "LD V%X, K", x); return;
+                case 0x15: snprintf(buf, len, "LD DT, V%X", x); return;
+                case 0x18: snprintf(buf, len, "LD ST, V%X", x); return;
+                case 0x1E: snprintf(buf, len, "ADD I, V%X", x); return;
+                case 0x29: snprintf(buf, len, "LD F, V%X", x); return;
+                case 0x30: snprintf(buf, len, "LD HF, V%X", x); return;
+                case 0x3A: snprintf(buf, len, "PITCH V%X", x); return;
+                case 0x33: snprintf(buf, len, "LD B, V%X", x); return;
+                case 0x55: snprintf(buf, len, "LD [I], V%X", x); return;
+                case 0x65: snprintf(buf, len, "LD V%X, [I]", x); return;
+                case 0x75: snprintf(buf, len, "LD R, V%X", x); return;
+                case 0x85: snprintf(buf, len, "LD V%X, R", x); return;
+                default: break;
+            }
+            break;
+    }
+    snprintf(buf, len, "DW %04X", op);
+}
@@ -0,0 +1,175 @@
+#include "../include/audio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RING_SIZE 256
+#define RING_MASK (RING_SIZE - 1)
+#define AMPLITUDE 6000
+#define WAV_CHUNK 1024
+
+typedef struct {
+    uint64_t sample;
+    bool on;
+} edge;
+
+struct audio_state {
+    int rate;
+    int latency;
+    uint64_t clock; // instructions per second
+    uint32_t step;
+
+    // producer side, written by the emulation thread
+    edge ring[RING_SIZE];
+    uint32_t head;
+    uint64_t now;
+    uint32_t dropped;
+
+    // consumer side, owned by the audio callback or audio_pump()
+    uint32_t tail;
+    uint64_t play;
+    uint32_t phase;
+    bool on;
+
+    FILE* wav;
+    uint32_t wav_samples;
+};
+
+static uint64_t to_sample(audio a, uint64_t cycle) {
+    return cycle * (uint64_t)a->rate / a->clock;
+}
+
+audio create_audio(int rate, int buffer_samples) {
+    audio a = (audio)calloc(1, sizeof(struct audio_state));
+    if (!a) {
+        fprintf(stderr, "Failed to allocate memory for audio\n");
+        exit(EXIT_FAILURE);
+    }
+    a->rate = rate;
+    a->clock = CYCLES_PER_SECOND;
+    a->step = (uint32_t)(((uint64_t)AUDIO_TONE << 32) / (uint64_t)rate);
+    // the emulator runs a whole frame at a time, so keep a frame of slack
+    // on top of the device buffer
+    a->latency = buffer_samples + rate / 60;
+    return a;
+}
+
+static void write_wav_header(audio a) {
+    uint32_t data = a->wav_samples * 2;
+    uint8_t h[44];
+    memcpy(h, "RIFF", 4);
+    uint32_t v = 36 + data;
+    memcpy(h + 4, &v, 4);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    v = 16;
+    memcpy(h + 16, &v, 4);
+    uint16_t s = 1; // PCM
+    memcpy(h + 20, &s, 2);
+    memcpy(h + 22, &s, 2); // mono
+    v = (uint32_t)a->rate;
+    memcpy(h + 24, &v, 4);
+    v = (uint32_t)a->rate * 2;
+    memcpy(h + 28, &v, 4);
+    s = 2;
+    memcpy(h + 32, &s, 2);
+    s = 16;
+    memcpy(h + 34, &s, 2);
+    memcpy(h + 36, "data", 4);
+    memcpy(h + 40, &data, 4);
+    fseek(a->wav, 0, SEEK_SET);
+    fwrite(h, 1, sizeof(h), a->wav);
+    fseek(a->wav, 0, SEEK_END);
+}
+
+void destroy_audio(audio a) {
+    if (a->wav) {
+        write_wav_header(a);
+        fclose(a->wav);
+    }
+    if (a->dropped) {
+        fprintf(stderr, "audio: dropped %u buzzer edges\n", a->dropped);
+    }
+    free(a);
+}
+
+static void push_edge(void* ctx, bool on, uint64_t cycle) {
+    audio a = ctx;
+    uint32_t head = __atomic_load_n(&a->head, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(&a->tail, __ATOMIC_ACQUIRE);
+    if (head - tail == RING_SIZE) {
+        a->dropped++;
+        return;
+    }
+    a->ring[head & RING_MASK].sample = to_sample(a, cycle);
+    a->ring[head & RING_MASK].on = on;
+    __atomic_store_n(&a->head, head + 1, __ATOMIC_RELEASE);
+}
+
+// Edges are stamped in instructions, so attach after the speed is set.
+void attach_audio(audio a, chip8 emu) {
+    a->clock = (uint64_t)get_speed(emu) * 60;
+    set_buzzer(emu, push_edge, a);
+}
+
+// Synthesises `n` samples starting at the consumer's play position.
+static void synth(audio a, int16_t* out, int n) {
+    uint32_t tail = a->tail;
+    uint32_t head = __atomic_load_n(&a->head, __ATOMIC_ACQUIRE);
+
+    for (int i = 0; i < n; i++) {
+        while (tail != head && a->ring[tail & RING_MASK].sample <= a->play) {
+            a->on = a->ring[tail & RING_MASK].on;
+            tail++;
+        }
+        out[i] = a->on ? ((a->phase & 0x80000000u) ? AMPLITUDE : -AMPLITUDE) : 0;
+        a->phase += a->step;
+        a->play++;
+    }
+    __atomic_store_n(&a->tail, tail, __ATOMIC_RELEASE);
+}
+
+// Audio device callback side. Runs `latency` samples behind the emulator;
+// if it falls further behind it skips ahead, and if it catches up with the
+// emulator (paused, or running slow) it plays silence instead of guessing.
+void audio_render(audio a, int16_t* out, int n) {
+    uint64_t now = __atomic_load_n(&a->now, __ATOMIC_RELAXED);
+    uint64_t target = now > (uint64_t)a->latency ? now - a->latency : 0;
+
+    if (a->play + a->latency < target) {
+        a->play = target;
+    }
+    int ahead = 0;
+    if (a->play + n > now) {
+        ahead = a->play >= now ? n : (int)(a->play + n - now);
+    }
+    synth(a, out, n - ahead);
+    memset(out + (n - ahead), 0, ahead * sizeof(int16_t));
+}
+
+int open_wav(audio a, const char* path) {
+    a->wav = fopen(path, "wb");
+    if (!a->wav) {
+        perror(path);
+        return -1;
+    }
+    write_wav_header(a);
+    return 0;
+}
+
+// Called by the emulation thread once per frame. Publishes the emulated
+// time for the device callback, or renders up to it into the WAV file.
+void audio_pump(audio a, chip8 emu) {
+    uint64_t now = to_sample(a, get_cycles(emu));
+    if (!a->wav) {
+        __atomic_store_n(&a->now, now, __ATOMIC_RELAXED);
+        return;
+    }
+
+    int16_t buf[WAV_CHUNK];
+    while (a->play < now) {
+        int n = now - a->play > WAV_CHUNK ? WAV_CHUNK : (int)(now - a->play);
+        synth(a, buf, n);
+        fwrite(buf, sizeof(int16_t), n, a->wav);
+        a->wav_samples += n;
+    }
+}
@@ -0,0 +1,510 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/catalog.h"
+#include "../include/hash.h"
+#include "../include/helpers.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAX_DEPTH 16
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t strings; // offset of the string table
+} catalog_header;
+
+struct catalog_state {
+    const uint8_t* base;
+    size_t size;
+    uint32_t count;
+    const catalog_entry* entries;
+    const char* strings;
+    size_t strings_size;
+};
+
+// A ROM being indexed, before its strings go into the table.
+typedef struct {
+    catalog_entry e;
+    char* path;
+    char* title;
+    char* quirks;
+} record;
+
+typedef struct {
+    record* items;
+    int count;
+    int capacity;
+} record_list;
+
+typedef struct {
+    uint64_t hash;
+    uint8_t platform;
+    uint8_t speed;
+    char quirks[32];
+    char title[128];
+} meta;
+
+typedef struct {
+    const char* path;
+    const catalog_entry* e;
+} old_entry;
+
+static const char* PLATFORM_NAMES[PLATFORM_COUNT] = { "chip8", "schip", "xochip" };
+
+const char* platform_name(int platform) {
+    return platform >= 0 && platform < PLATFORM_COUNT ? PLATFORM_NAMES[platform] : "?";
+}
+
+static int parse_platform(const char* name) {
+    for (int i = 0; i < PLATFORM_COUNT; i++) {
+        if (strcmp(name, PLATFORM_NAMES[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Maps a ROM file read-only. The caller copies it into an instance and
+// unmaps it; nothing is buffered in between.
+const uint8_t* map_rom(const char* path, size_t* size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror(path);
+        close(fd);
+        return NULL;
+    }
+    if (!S_ISREG(st.st_mode) || st.st_size <= 0) {
+        fprintf(stderr, "%s: not a ROM file\n", path);
+        close(fd);
+        return NULL;
+    }
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror(path);
+        return NULL;
+    }
+    *size = (size_t)st.st_size;
+    return data;
+}
+
+void unmap_rom(const uint8_t* data, size_t size) {
+    munmap((void*)data, size);
+}
+
+catalog open_catalog(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(catalog_header)) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    void* base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+
+    const catalog_header* h = base;
+    size_t entries_end = sizeof(*h) + (size_t)h->count * sizeof(catalog_entry);
+    // the string table must be NUL terminated so every offset is safe
+    if (h->magic != CATALOG_MAGIC || h->version != CATALOG_VERSION
+            || entries_end > h->strings || h->strings >= size
+            || ((const char*)base)[size - 1] != '\0') {
+        fprintf(stderr, "%s: not a ROM catalog, rebuild it\n", path);
+        munmap(base, size);
+        return NULL;
+    }
+
+    catalog c = (catalog)malloc(sizeof(struct catalog_state));
+    if (!c) {
+        fprintf(stderr, "Failed to allocate memory for catalog\n");
+        exit(EXIT_FAILURE);
+    }
+    c->base = base;
+    c->size = size;
+    c->count = h->count;
+    c->entries = (const catalog_entry*)(c->base + sizeof(*h));
+    c->strings = (const char*)c->base + h->strings;
+    c->strings_size = size - h->strings;
+    return c;
+}
+
+void close_catalog(catalog c) {
+    munmap((void*)c->base, c->size);
+    free(c);
+}
+
+int catalog_count(catalog c) {
+    return (int)c->count;
+}
+
+const catalog_entry* catalog_at(catalog c, int i) {
+    return &c->entries[i];
+}
+
+const char* catalog_string(catalog c, uint32_t offset) {
+    return offset < c->strings_size ? c->strings + offset : "";
+}
+
+static bool contains_nocase(const char* s, const char* needle) {
+    size_t n = strlen(needle);
+    for (; *s; s++) {
+        size_t i = 0;
+        while (i < n && tolower((unsigned char)s[i]) == tolower((unsigned char)needle[i])) {
+            i++;
+        }
+        if (i == n) {
+            return true;
+        }
+    }
+    return n == 0;
+}
+
+static bool hash_prefix(uint64_t hash, const char* query) {
+    size_t n = strlen(query);
+    if (n < 4 || n > 16) {
+        return false;
+    }
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llX", (unsigned long long)hash);
+    for (size_t i = 0; i < n; i++) {
+        if (toupper((unsigned char)query[i]) != hex[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns the index of the first entry from `start` whose hash starts with
+// `query`, whose path is `query`, or whose title contains it; -1 if none.
+int catalog_find(catalog c, const char* query, int start) {
+    for (int i = start; i < (int)c->count; i++) {
+        const catalog_entry* e = &c->entries[i];
+        if (hash_prefix(e->hash, query) || strcmp(catalog_string(c, e->path), query) == 0
+                || contains_nocase(catalog_string(c, e->title), query)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int load_catalog_rom(chip8 emu, catalog c, const catalog_entry* e) {
+    const char* path = catalog_string(c, e->path);
+    size_t size;
+    const uint8_t* rom = map_rom(path, &size);
+    if (!rom) {
+        return -1;
+    }
+    if (size > RAM_SIZE - START_ADDR) {
+        fprintf(stderr, "%s: ROM size exceeds available memory\n", path);
+        unmap_rom(rom, size);
+        return -1;
+    }
+    if (size != e->size || hash64(rom, size, 0) != e->hash) {
+        fprintf(stderr, "%s: changed since it was indexed\n", path);
+    }
+    load(emu, rom, size);
+    unmap_rom(rom, size);
+    if (e->speed) {
+        set_speed(emu, e->speed);
+    }
+    return 0;
+}
+
+static char* copy_string(const char* s) {
+    char* copy = strdup(s);
+    if (!copy) {
+        fprintf(stderr, "Failed to allocate memory for catalog\n");
+        exit(EXIT_FAILURE);
+    }
+    return copy;
+}
+
+static record* add_record(record_list* list) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 256;
+        list->items = realloc(list->items, sizeof(record) * (size_t)list->capacity);
+        if (!list->items) {
+            fprintf(stderr, "Failed to allocate memory for catalog\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    record* r = &list->items[list->count++];
+    memset(r, 0, sizeof(*r));
+    return r;
+}
+
+static int compare_old(const void* a, const void* b) {
+    return strcmp(((const old_entry*)a)->path, ((const old_entry*)b)->path);
+}
+
+static int compare_meta(const void* a, const void* b) {
+    uint64_t x = ((const meta*)a)->hash;
+    uint64_t y = ((const meta*)b)->hash;
+    return x < y ? -1 : x > y;
+}
+
+static int compare_record(const void* a, const void* b) {
+    const record* x = a;
+    const record* y = b;
+    if (x->e.hash != y->e.hash) {
+        return x->e.hash < y->e.hash ? -1 : 1;
+    }
+    return strcmp(x->path, y->path);
+}
+
+// "games/Space_Invaders.ch8" -> "Space Invaders"
+static char* default_title(const char* path) {
+    const char* slash = strrchr(path, '/');
+    char* title = copy_string(slash ? slash + 1 : path);
+    char* dot = strrchr(title, '.');
+    if (dot && dot != title) {
+        *dot = '\0';
+    }
+    for (char* p = title; *p; p++) {
+        if (*p == '_') {
+            *p = ' ';
+        }
+    }
+    return title;
+}
+
+static uint8_t default_platform(const char* path) {
+    const char* dot = strrchr(path, '.');
+    if (dot && strcmp(dot, ".sc8") == 0) {
+        return PLATFORM_SCHIP;
+    }
+    if (dot && strcmp(dot, ".xo8") == 0) {
+        return PLATFORM_XOCHIP;
+    }
+    return PLATFORM_CHIP8;
+}
+
+static void scan(const char* dir, int depth, record_list* list, const old_entry* old, int nold) {
+    DIR* d = opendir(dir);
+    if (!d) {
+        perror(dir);
+        return;
+    }
+    struct dirent* ent;
+    while ((ent = readdir(d)) != NULL) {
+        if (ent->d_name[0] == '.') {
+            continue;
+        }
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+        struct stat st;
+        if (stat(path, &st) != 0) {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            if (depth < MAX_DEPTH) {
+                scan(path, depth + 1, list, old, nold);
+            }
+            continue;
+        }
+        if (!S_ISREG(st.st_mode) || st.st_size <= 0 || st.st_size > RAM_SIZE - START_ADDR) {
+            continue;
+        }
+
+        record* r = add_record(list);
+        r->path = copy_string(path);
+        r->e.size = (uint32_t)st.st_size;
+        r->e.mtime = (int64_t)st.st_mtime;
+
+        old_entry key = { path, NULL };
+        const old_entry* prev = nold ? bsearch(&key, old, (size_t)nold, sizeof(*old), compare_old) : NULL;
+        if (prev && prev->e->size == r->e.size && prev->e->mtime == r->e.mtime) {
+            r->e.hash = prev->e->hash;
+            continue;
+        }
+        size_t size;
+        const uint8_t* rom = map_rom(path, &size);
+        if (!rom) {
+            free(r->path);
+            list->count--;
+            continue;
+        }
+        r->e.hash = hash64(rom, size, 0);
+        unmap_rom(rom, size);
+    }
+    closedir(d);
+}
+
+static meta* load_meta(const char* path, int* count) {
+    *count = 0;
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    meta* list = NULL;
+    int capacity = 0;
+    char line[512];
+    int lineno = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        unsigned long long hash;
+        char platform[16];
+        unsigned speed;
+        char quirks[32];
+        int title_at = 0;
+        if (sscanf(line, "%llx %15s %u %31s %n", &hash, platform, &speed, quirks, &title_at) != 4
+                || !title_at || parse_platform(platform) < 0 || speed > 255) {
+            fprintf(stderr, "%s:%d: expected <hash> <platform> <speed> <quirks|-> <title>\n", path, lineno);
+            continue;
+        }
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            list = realloc(list, sizeof(meta) * (size_t)capacity);
+            if (!list) {
+                fprintf(stderr, "Failed to allocate memory for catalog\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        meta* m = &list[(*count)++];
+        m->hash = hash;
+        m->platform = (uint8_t)parse_platform(platform);
+        m->speed = (uint8_t)speed;
+        snprintf(m->quirks, sizeof(m->quirks), "%s", strcmp(quirks, "-") == 0 ? "" : quirks);
+        snprintf(m->title, sizeof(m->title), "%s", line + title_at);
+        m->title[strcspn(m->title, "\r\n")] = '\0';
+    }
+    fclose(f);
+    qsort(list, (size_t)*count, sizeof(meta), compare_meta);
+    return list;
+}
+
+static uint32_t add_string(char** table, size_t* len, size_t* capacity, const char* s) {
+    size_t n = strlen(s) + 1;
+    while (*len + n > *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 4096;
+        *table = realloc(*table, *capacity);
+        if (!*table) {
+            fprintf(stderr, "Failed to allocate memory for catalog\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    uint32_t offset = (uint32_t)*len;
+    memcpy(*table + *len, s, n);
+    *len += n;
+    return offset;
+}
+
+static int write_catalog(const char* path, record_list* list) {
+    char* strings = NULL;
+    size_t len = 0;
+    size_t capacity = 0;
+    add_string(&strings, &len, &capacity, ""); // offset 0 is the empty string
+    for (int i = 0; i < list->count; i++) {
+        record* r = &list->items[i];
+        r->e.path = add_string(&strings, &len, &capacity, r->path);
+        r->e.title = add_string(&strings, &len, &capacity, r->title);
+        r->e.quirks = r->quirks[0] ? add_string(&strings, &len, &capacity, r->quirks) : 0;
+    }
+
+    catalog_header h;
+    h.magic = CATALOG_MAGIC;
+    h.version = CATALOG_VERSION;
+    h.count = (uint32_t)list->count;
+    h.strings = (uint32_t)(sizeof(h) + sizeof(catalog_entry) * (size_t)list->count);
+
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE* f = fopen(tmp, "wb");
+    if (!f) {
+        perror(tmp);
+        free(strings);
+        return -1;
+    }
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    for (int i = 0; ok && i < list->count; i++) {
+        ok = fwrite(&list->items[i].e, sizeof(catalog_entry), 1, f) == 1;
+    }
+    ok = ok && fwrite(strings, 1, len, f) == len;
+    ok = fclose(f) == 0 && ok;
+    free(strings);
+    // readers keep the old index mapped until they reopen it
+    if (!ok || rename(tmp, path) != 0) {
+        perror(path);
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+// Scans `dir` recursively and writes the index to `path`, reusing hashes
+// from the existing index for files whose size and mtime are unchanged.
+// `meta_path` may be NULL. Returns the number of ROMs indexed, or -1.
+int build_catalog(const char* path, const char* dir, const char* meta_path) {
+    catalog prev = open_catalog(path);
+    int nold = prev ? catalog_count(prev) : 0;
+    old_entry* old = malloc(sizeof(old_entry) * (size_t)(nold ? nold : 1));
+    if (!old) {
+        fprintf(stderr, "Failed to allocate memory for catalog\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < nold; i++) {
+        old[i].e = catalog_at(prev, i);
+        old[i].path = catalog_string(prev, old[i].e->path);
+    }
+    qsort(old, (size_t)nold, sizeof(old_entry), compare_old);
+
+    record_list list = { NULL, 0, 0 };
+    scan(dir, 0, &list, old, nold);
+    free(old);
+    if (prev) {
+        close_catalog(prev);
+    }
+
+    int nmeta = 0;
+    meta* metas = meta_path ? load_meta(meta_path, &nmeta) : NULL;
+    for (int i = 0; i < list.count; i++) {
+        record* r = &list.items[i];
+        meta key;
+        key.hash = r->e.hash;
+        const meta* m = nmeta ? bsearch(&key, metas, (size_t)nmeta, sizeof(meta), compare_meta) : NULL;
+        if (m) {
+            r->title = copy_string(m->title);
+            r->quirks = copy_string(m->quirks);
+            r->e.platform = m->platform;
+            r->e.speed = m->speed;
+        } else {
+            r->title = default_title(r->path);
+            r->quirks = copy_string("");
+            r->e.platform = default_platform(r->path);
+        }
+    }
+    free(metas);
+
+    qsort(list.items, (size_t)list.count, sizeof(record), compare_record);
+    int status = write_catalog(path, &list);
+    for (int i = 0; i < list.count; i++) {
+        free(list.items[i].path);
+        free(list.items[i].title);
+        free(list.items[i].quirks);
+    }
+    free(list.items);
+    return status == 0 ? list.count : -1;
+}
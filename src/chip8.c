@@ -1,4 +1,5 @@
 #include "../include/chip8.h"
+#include "../include/chip8_impl.h"
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -6,17 +7,9 @@
 #include <string.h>
 #include <time.h>
 #include "../include/helpers.h"
+#include "../include/engine.h"
+#include "../include/hash.h"
 
-#define RAM_SIZE 4096
-#define SCREEN_WIDTH 64
-#define SCREEN_HEIGHT 32
-#define NUM_REGS 16
-#define STACK_SIZE 16
-#define NUM_KEYS 16
-
-#define START_ADDR 0x200
-
-#define FONTSET_SIZE 80
 const uint8_t FONTSET[FONTSET_SIZE] = {
     0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
     0x20, 0x60, 0x20, 0x20, 0x70, // 1
@@ -36,26 +29,40 @@ const uint8_t FONTSET[FONTSET_SIZE] = {
     0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
-struct chip8emu {
-    uint16_t pc;
-    uint8_t ram[RAM_SIZE];
-    bool screen[SCREEN_WIDTH * SCREEN_HEIGHT];
-    uint8_t v_reg[NUM_REGS];
-    uint16_t i_reg;
-    uint16_t sp;
-    uint16_t stack[STACK_SIZE];
-    bool keys[NUM_KEYS];
-    uint8_t dt;
-    uint8_t st;
+const uint8_t BIGFONT[BIGFONT_SIZE] = {
+    0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+    0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+    0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+    0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+    0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+    0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+    0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+    0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+    0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+    0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+    0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+    0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
 };
 
 chip8 init_emulator(void) {
-    srand(time(NULL));
     chip8 emu = (chip8)malloc(sizeof(struct chip8emu));
     if (!emu) {
         fprintf(stderr, "Failed to allocate memory for emulator\n");
         exit(EXIT_FAILURE);
     }
+    emu->trace = false;
+    emu->rng = (uint32_t)time(NULL) | 1;
+    emu->engine = default_engine();
+    emu->buzzer = NULL;
+    emu->buzzer_ctx = NULL;
+    emu->coverage = NULL;
+    emu->speed = TICKS_PER_FRAME;
+    memset(emu->ram, 0, sizeof(emu->ram));
+    emu->ram_sum = 0;
     reset(emu);
     return emu;
 }
@@ -64,6 +71,37 @@ void destroy_emulator(chip8 emu) {
     free(emu);
 }
 
+chip8 clone_emulator(chip8 src) {
+    chip8 emu = (chip8)malloc(sizeof(struct chip8emu));
+    if (!emu) {
+        fprintf(stderr, "Failed to allocate memory for emulator\n");
+        exit(EXIT_FAILURE);
+    }
+    *emu = *src;
+    return emu;
+}
+
+void copy_emulator(chip8 dst, chip8 src) {
+    *dst = *src;
+}
+
+// Covers everything the ROM can observe. The RNG state is included so that
+// two instances only compare equal if they will keep producing the same
+// CXNN results.
+uint64_t hash_state(chip8 emu) {
+    uint64_t h = hash64(&emu->ram_sum, sizeof(emu->ram_sum), emu->pc);
+    h = hash64(emu->screen, sizeof(emu->screen), h);
+    h = hash64(emu->v_reg, sizeof(emu->v_reg), h);
+    h = hash64(emu->stack, sizeof(emu->stack), h);
+    h = hash64(emu->keys, sizeof(emu->keys), h);
+    h = hash64(emu->flags, sizeof(emu->flags), h);
+    uint64_t regs = (uint64_t)emu->i_reg | (uint64_t)emu->sp << 16
+        | (uint64_t)emu->dt << 32 | (uint64_t)emu->st << 40
+        | (uint64_t)emu->hires << 48 | (uint64_t)emu->planes << 56;
+    h = hash64(&regs, sizeof(regs), h);
+    return hash64(&emu->rng, sizeof(emu->rng), h);
+}
+
 uint16_t get_pc(chip8 emu) {
     return emu->pc;
 }
@@ -73,23 +111,73 @@ void set_pc(chip8 emu, uint16_t value) {
 }
 
 uint8_t get_ram(chip8 emu, int index) {
-    return emu->ram[index];
+    return emu->ram[index & ADDR_MASK];
 }
 
-uint8_t* get_ram_ptr(chip8 emu, int address) {
-    return &emu->ram[address];
+// Read only: writes go through set_ram() or set_ram_range() so that the
+// RAM term of hash_state() stays current.
+const uint8_t* get_ram_ptr(chip8 emu, int address) {
+    return &emu->ram[address & ADDR_MASK];
 }
 
 void set_ram(chip8 emu, uint8_t value, int index) {
-    emu->ram[index] = value;
+    STORE_RAM(emu, index & ADDR_MASK, value);
+    invalidate_code(emu, index & ADDR_MASK, 1);
+}
+
+void set_ram_range(chip8 emu, const uint8_t* data, int address, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        STORE_RAM(emu, (address + i) & ADDR_MASK, data[i]);
+    }
+    invalidate_code(emu, address & ADDR_MASK, (int)len);
+}
+
+// Forgets the superinstructions overlapping [start, start + len), including
+// those starting up to two instructions earlier.
+void invalidate_code(chip8 emu, int start, int len) {
+    if (len >= RAM_SIZE - 2 * FUSED_MAX) {
+        memset(emu->fused, FUSED_UNKNOWN, sizeof(emu->fused));
+        return;
+    }
+    for (int i = start - 2 * (FUSED_MAX - 1); i < start + len; i++) {
+        emu->fused[(uint16_t)i] = FUSED_UNKNOWN;
+    }
+}
+
+uint64_t* get_plane(chip8 emu, int plane) {
+    return &emu->screen[plane][0][0];
+}
+
+bool get_hires(chip8 emu) {
+    return emu->hires;
+}
+
+void set_hires(chip8 emu, bool value) {
+    emu->hires = value;
+}
+
+uint8_t get_planes(chip8 emu) {
+    return emu->planes;
 }
 
-bool get_screen(chip8 emu, int index) {
-    return emu->screen[index];
+void set_planes(chip8 emu, uint8_t mask) {
+    emu->planes = mask;
 }
 
-void set_screen(chip8 emu, bool value, int index) {
-    emu->screen[index] = value;
+int screen_width(chip8 emu) {
+    return emu->hires ? HIRES_WIDTH : SCREEN_WIDTH;
+}
+
+int screen_height(chip8 emu) {
+    return emu->hires ? HIRES_HEIGHT : SCREEN_HEIGHT;
+}
+
+uint8_t get_rpl(chip8 emu, int index) {
+    return emu->flags[index];
+}
+
+void set_rpl(chip8 emu, uint8_t value, int index) {
+    emu->flags[index] = value;
 }
 
 uint8_t get_vreg(chip8 emu, int index) {
@@ -147,8 +235,99 @@ void set_st(chip8 emu, uint8_t value) {
     emu->st = value;
 }
 
-bool* get_display(chip8 emu) {
-    return emu->screen;
+bool get_trace(chip8 emu) {
+    return emu->trace;
+}
+
+void set_trace(chip8 emu, bool value) {
+    emu->trace = value;
+}
+
+uint32_t get_rng(chip8 emu) {
+    return emu->rng;
+}
+
+void set_rng(chip8 emu, uint32_t value) {
+    // xorshift gets stuck at zero
+    emu->rng = value ? value : 1;
+}
+
+const struct engine* get_engine(chip8 emu) {
+    return emu->engine;
+}
+
+void set_engine(chip8 emu, const struct engine* engine) {
+    emu->engine = engine;
+    // writes made by other engines were not tracked
+    invalidate_code(emu, 0, RAM_SIZE);
+}
+
+uint64_t get_cycles(chip8 emu) {
+    return emu->cycles;
+}
+
+void set_cycles(chip8 emu, uint64_t value) {
+    emu->cycles = value;
+}
+
+uint64_t get_draws(chip8 emu) {
+    return emu->draws;
+}
+
+void set_draws(chip8 emu, uint64_t value) {
+    emu->draws = value;
+}
+
+int get_speed(chip8 emu) {
+    return emu->speed;
+}
+
+void set_speed(chip8 emu, int value) {
+    emu->speed = value;
+}
+
+uint8_t get_faults(chip8 emu) {
+    return emu->faults;
+}
+
+void set_faults(chip8 emu, uint8_t value) {
+    emu->faults = value;
+}
+
+void raise_fault(chip8 emu, uint8_t fault) {
+    emu->faults |= fault;
+}
+
+// The name of a single fault bit.
+const char* fault_name(uint8_t fault) {
+    switch (fault) {
+        case FAULT_ADDRESS: return "address wrapped past end of RAM";
+        case FAULT_STACK_OVERFLOW: return "stack overflow";
+        case FAULT_STACK_UNDERFLOW: return "stack underflow";
+        case FAULT_KEY: return "key index above F";
+        case FAULT_OPCODE: return "unknown opcode";
+        default: return "unknown fault";
+    }
+}
+
+uint8_t* get_coverage(chip8 emu) {
+    return emu->coverage;
+}
+
+// Only the reference engine records coverage. Clones share the bitmap.
+void set_coverage(chip8 emu, uint8_t* map) {
+    emu->coverage = map;
+}
+
+void set_buzzer(chip8 emu, buzzer_fn fn, void* ctx) {
+    emu->buzzer = fn;
+    emu->buzzer_ctx = ctx;
+}
+
+void sound_edge(chip8 emu, bool on) {
+    if (emu->buzzer) {
+        emu->buzzer(emu->buzzer_ctx, on, emu->cycles);
+    }
 }
 
 // void keypress(chip8 emu, uint16_t index, bool pressed) {
@@ -0,0 +1,430 @@
+#include "../include/debug.h"
+#include "../include/analyze.h"
+#include "../include/engine.h"
+#include "../include/helpers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BP_BREAK 1
+#define BP_COND 2
+#define BP_TEMP 4
+
+#define PAGE_SHIFT 8
+#define NUM_PAGES (RAM_SIZE >> PAGE_SHIFT)
+
+#define MAX_CONDITIONS 64
+#define MAX_WATCHES 32
+
+#define REG_I NUM_REGS
+
+typedef enum { OP_EQ, OP_NE, OP_LT, OP_GT, OP_LE, OP_GE } compare_op;
+
+typedef struct {
+    uint16_t addr;
+    int reg;
+    compare_op op;
+    uint16_t value;
+} condition;
+
+typedef struct {
+    uint16_t start;
+    uint16_t len;
+    int mode;
+} watch;
+
+struct debugger_state {
+    uint8_t bp[RAM_SIZE];
+    uint8_t pages[NUM_PAGES];
+    int nbreak;
+    condition conds[MAX_CONDITIONS];
+    int nconds;
+    watch watches[MAX_WATCHES];
+    int nwatches;
+    bool paused;
+    bool resume;
+    int step;
+    int frame_tick;
+};
+
+debugger create_debugger(void) {
+    debugger dbg = (debugger)calloc(1, sizeof(struct debugger_state));
+    if (!dbg) {
+        fprintf(stderr, "Failed to allocate memory for debugger\n");
+        exit(EXIT_FAILURE);
+    }
+    return dbg;
+}
+
+void destroy_debugger(debugger dbg) {
+    free(dbg);
+}
+
+static void set_flag(debugger dbg, uint16_t addr, uint8_t flag) {
+    addr &= ADDR_MASK;
+    if (!dbg->bp[addr]) {
+        dbg->nbreak++;
+    }
+    dbg->bp[addr] |= flag;
+}
+
+static void clear_flag(debugger dbg, uint16_t addr, uint8_t flag) {
+    addr &= ADDR_MASK;
+    if (!dbg->bp[addr]) {
+        return;
+    }
+    dbg->bp[addr] &= ~flag;
+    if (!dbg->bp[addr]) {
+        dbg->nbreak--;
+    }
+}
+
+void add_breakpoint(debugger dbg, uint16_t addr) {
+    set_flag(dbg, addr, BP_BREAK);
+}
+
+// Condition syntax: "vX OP VALUE" or "i OP VALUE", OP one of == != < > <= >=,
+// VALUE in hex.
+int add_conditional_breakpoint(debugger dbg, uint16_t addr, const char* expr) {
+    static const char* OPS[] = { "==", "!=", "<", ">", "<=", ">=" };
+    char reg[8];
+    char op[4];
+    unsigned value;
+
+    if (dbg->nconds == MAX_CONDITIONS
+            || sscanf(expr, "%7s %3s %x", reg, op, &value) != 3) {
+        return -1;
+    }
+
+    condition c;
+    c.addr = addr & ADDR_MASK;
+    c.value = (uint16_t)value;
+    if ((reg[0] == 'v' || reg[0] == 'V') && reg[1] && !reg[2]) {
+        char* end;
+        c.reg = (int)strtol(&reg[1], &end, 16);
+        if (*end) {
+            return -1;
+        }
+    } else if ((reg[0] == 'i' || reg[0] == 'I') && !reg[1]) {
+        c.reg = REG_I;
+    } else {
+        return -1;
+    }
+
+    int found = -1;
+    for (int i = 0; i < 6; i++) {
+        if (strcmp(op, OPS[i]) == 0) {
+            found = i;
+        }
+    }
+    if (found < 0) {
+        return -1;
+    }
+    c.op = (compare_op)found;
+
+    dbg->conds[dbg->nconds++] = c;
+    set_flag(dbg, addr, BP_COND);
+    return 0;
+}
+
+void remove_breakpoint(debugger dbg, uint16_t addr) {
+    addr &= ADDR_MASK;
+    for (int i = 0; i < dbg->nconds; i++) {
+        if (dbg->conds[i].addr == addr) {
+            dbg->conds[i--] = dbg->conds[--dbg->nconds];
+        }
+    }
+    clear_flag(dbg, addr, BP_BREAK | BP_COND | BP_TEMP);
+}
+
+static void rebuild_pages(debugger dbg) {
+    memset(dbg->pages, 0, sizeof(dbg->pages));
+    for (int i = 0; i < dbg->nwatches; i++) {
+        watch* w = &dbg->watches[i];
+        for (int p = w->start >> PAGE_SHIFT; p <= (w->start + w->len - 1) >> PAGE_SHIFT; p++) {
+            dbg->pages[p] |= (uint8_t)w->mode;
+        }
+    }
+}
+
+int add_watchpoint(debugger dbg, uint16_t start, uint16_t len, int mode) {
+    if (dbg->nwatches == MAX_WATCHES || len == 0
+            || start + len > RAM_SIZE || !(mode & (WATCH_READ | WATCH_WRITE))) {
+        return -1;
+    }
+    watch* w = &dbg->watches[dbg->nwatches++];
+    w->start = start;
+    w->len = len;
+    w->mode = mode;
+    rebuild_pages(dbg);
+    return 0;
+}
+
+void remove_watchpoint(debugger dbg, uint16_t start) {
+    for (int i = 0; i < dbg->nwatches; i++) {
+        if (dbg->watches[i].start == start) {
+            dbg->watches[i--] = dbg->watches[--dbg->nwatches];
+        }
+    }
+    rebuild_pages(dbg);
+}
+
+bool debug_armed(debugger dbg) {
+    return dbg->nbreak || dbg->nwatches || dbg->paused || dbg->step || dbg->frame_tick;
+}
+
+bool debug_paused(debugger dbg) {
+    return dbg->paused;
+}
+
+void debug_break(debugger dbg) {
+    dbg->paused = true;
+}
+
+static bool condition_true(const condition* c, chip8 emu) {
+    uint16_t v = c->reg == REG_I ? get_ireg(emu) : get_vreg(emu, c->reg);
+    switch (c->op) {
+        case OP_EQ: return v == c->value;
+        case OP_NE: return v != c->value;
+        case OP_LT: return v < c->value;
+        case OP_GT: return v > c->value;
+        case OP_LE: return v <= c->value;
+        case OP_GE: return v >= c->value;
+    }
+    return false;
+}
+
+static bool breakpoint_hit(debugger dbg, chip8 emu, uint16_t pc) {
+    uint8_t flags = dbg->bp[pc];
+    if (flags & BP_TEMP) {
+        clear_flag(dbg, pc, BP_TEMP);
+        return true;
+    }
+    if (flags & BP_BREAK) {
+        return true;
+    }
+    for (int i = 0; i < dbg->nconds; i++) {
+        if (dbg->conds[i].addr == pc && condition_true(&dbg->conds[i], emu)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The RAM range an opcode touches through I, or 0 if it touches none,
+// counted as the engine running it does.
+static int memory_access(chip8 emu, uint16_t op, uint16_t* start, uint16_t* len) {
+    const struct engine* eng = get_engine(emu);
+    uint8_t x = (op >> 8) & 0xF;
+    *start = get_ireg(emu);
+    if ((op & 0xF000) == 0xD000) {
+        // DXY0 is a 16x16 sprite; each selected plane reads its own copy
+        int rows = op & 0xF ? op & 0xF : eng->big_sprites ? 32 : 0;
+        int planes = (get_planes(emu) & 1) + (get_planes(emu) >> 1 & 1);
+        *len = (uint16_t)(rows * planes);
+        return *len ? WATCH_READ : 0;
+    }
+    if ((op & 0xF00E) == 0x5002) {
+        // 5XY2/5XY3, VX..VY in either order
+        uint8_t y = (op >> 4) & 0xF;
+        *len = (x > y ? x - y : y - x) + 1;
+        return op & 1 ? WATCH_READ : WATCH_WRITE;
+    }
+    if ((op & 0xF000) != 0xF000) {
+        return 0;
+    }
+    switch (op & 0xFF) {
+        case 0x33: *len = 3; return WATCH_WRITE;
+        case 0x55: *len = x + !eng->memory_short; return *len ? WATCH_WRITE : 0;
+        case 0x65: *len = x + !eng->memory_short; return *len ? WATCH_READ : 0;
+        default: return 0;
+    }
+}
+
+static bool watch_hit(debugger dbg, chip8 emu, uint16_t pc) {
+    uint16_t op = get_ram(emu, pc) << 8 | get_ram(emu, (pc + 1) & ADDR_MASK);
+    uint16_t start, len;
+    int mode = memory_access(emu, op, &start, &len);
+    if (!mode) {
+        return false;
+    }
+    if (start + len > RAM_SIZE) {
+        len = RAM_SIZE - start;
+    }
+
+    bool page = false;
+    for (int p = start >> PAGE_SHIFT; p <= (start + len - 1) >> PAGE_SHIFT; p++) {
+        page |= (dbg->pages[p] & mode) != 0;
+    }
+    if (!page) {
+        return false;
+    }
+
+    for (int i = 0; i < dbg->nwatches; i++) {
+        watch* w = &dbg->watches[i];
+        if ((w->mode & mode) && start < w->start + w->len && w->start < start + len) {
+            printf("watchpoint %03X+%X: %04X at %03X %s %03X-%03X\n", w->start, w->len, op, pc,
+                   mode == WATCH_WRITE ? "writes" : "reads", start, start + len - 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Runs the rest of the current frame under the debugger. Returns true when
+// the frame completed, false when it stopped at a breakpoint, watchpoint or
+// single step partway through.
+bool debug_frame(debugger dbg, chip8 emu) {
+    while (dbg->frame_tick < get_speed(emu)) {
+        if (dbg->paused) {
+            return false;
+        }
+        uint16_t pc = get_pc(emu) & ADDR_MASK;
+        if (dbg->resume) {
+            dbg->resume = false;
+        } else if (dbg->bp[pc] && breakpoint_hit(dbg, emu, pc)) {
+            printf("breakpoint at %03X\n", pc);
+            dbg->paused = true;
+            return false;
+        } else if (dbg->nwatches && watch_hit(dbg, emu, pc)) {
+            dbg->paused = true;
+            return false;
+        }
+
+        get_engine(emu)->run(emu, 1);
+        dbg->frame_tick++;
+        if (dbg->step && --dbg->step == 0) {
+            dbg->paused = true;
+        }
+    }
+    tick_timer(emu);
+    dbg->frame_tick = 0;
+    return true;
+}
+
+static void hexdump(chip8 emu, unsigned addr, unsigned len) {
+    for (unsigned i = 0; i < len && addr + i < RAM_SIZE; i++) {
+        if (i % 16 == 0) {
+            printf("%s%03X:", i ? "\n" : "", addr + i);
+        }
+        printf(" %02X", get_ram(emu, addr + i));
+    }
+    printf("\n");
+}
+
+static void list_points(debugger dbg) {
+    for (int a = 0; a < RAM_SIZE; a++) {
+        if (dbg->bp[a] & BP_BREAK) {
+            printf("break %03X\n", a);
+        }
+    }
+    for (int i = 0; i < dbg->nconds; i++) {
+        condition* c = &dbg->conds[i];
+        static const char* OPS[] = { "==", "!=", "<", ">", "<=", ">=" };
+        if (c->reg == REG_I) {
+            printf("break %03X if i %s %X\n", c->addr, OPS[c->op], c->value);
+        } else {
+            printf("break %03X if v%X %s %X\n", c->addr, c->reg, OPS[c->op], c->value);
+        }
+    }
+    for (int i = 0; i < dbg->nwatches; i++) {
+        watch* w = &dbg->watches[i];
+        printf("watch %03X+%X %s%s\n", w->start, w->len,
+               w->mode & WATCH_READ ? "r" : "", w->mode & WATCH_WRITE ? "w" : "");
+    }
+}
+
+static void help(void) {
+    printf("c                 continue\n");
+    printf("s                 step one instruction\n");
+    printf("n                 step, running a 2NNN call to its return\n");
+    printf("b ADDR [if COND]  break at ADDR, COND like 'v3 == 1F' or 'i >= 300'\n");
+    printf("d ADDR            delete breakpoints at ADDR\n");
+    printf("w ADDR LEN [r|w]  watch RAM reads and/or writes, default both\n");
+    printf("dw ADDR           delete the watchpoint starting at ADDR\n");
+    printf("l                 list breakpoints and watchpoints\n");
+    printf("r                 show registers\n");
+    printf("x ADDR [LEN]      dump memory\n");
+    printf("t                 toggle instruction trace\n");
+    printf("q                 quit\n");
+}
+
+// Reads commands until the user resumes execution. Returns false if the
+// user asked to quit.
+bool debug_repl(debugger dbg, chip8 emu, FILE* in) {
+    char line[256];
+    uint16_t pc = get_pc(emu) & ADDR_MASK;
+    uint16_t op = get_ram(emu, pc) << 8 | get_ram(emu, (pc + 1) & ADDR_MASK);
+    char text[32];
+    disassemble(op, text, sizeof(text));
+    printf("%03X: %04X  %s\n", pc, op, text);
+
+    for (;;) {
+        printf("(chip8) ");
+        fflush(stdout);
+        if (!fgets(line, sizeof(line), in)) {
+            return false;
+        }
+
+        char cmd[8] = "";
+        unsigned a = 0, b = 0;
+        char mode[4] = "";
+        int args = sscanf(line, "%7s %x %x %3s", cmd, &a, &b, mode);
+        if (args < 1) {
+            continue;
+        }
+
+        if (strcmp(cmd, "c") == 0) {
+            dbg->paused = false;
+            dbg->resume = true;
+            return true;
+        } else if (strcmp(cmd, "s") == 0) {
+            dbg->paused = false;
+            dbg->resume = true;
+            dbg->step = 1;
+            return true;
+        } else if (strcmp(cmd, "n") == 0) {
+            dbg->paused = false;
+            dbg->resume = true;
+            if ((get_ram(emu, pc) & 0xF0) == 0x20) {
+                set_flag(dbg, (pc + 2) & ADDR_MASK, BP_TEMP);
+            } else {
+                dbg->step = 1;
+            }
+            return true;
+        } else if (strcmp(cmd, "b") == 0 && args >= 2) {
+            const char* cond = strstr(line, " if ");
+            if (cond) {
+                if (add_conditional_breakpoint(dbg, (uint16_t)a, cond + 4) != 0) {
+                    printf("bad condition\n");
+                }
+            } else {
+                add_breakpoint(dbg, (uint16_t)a);
+            }
+        } else if (strcmp(cmd, "d") == 0 && args >= 2) {
+            remove_breakpoint(dbg, (uint16_t)a);
+        } else if (strcmp(cmd, "w") == 0 && args >= 3) {
+            int m = 0;
+            m |= strchr(mode, 'r') ? WATCH_READ : 0;
+            m |= strchr(mode, 'w') ? WATCH_WRITE : 0;
+            if (add_watchpoint(dbg, (uint16_t)a, (uint16_t)b, m ? m : WATCH_READ | WATCH_WRITE) != 0) {
+                printf("bad watchpoint\n");
+            }
+        } else if (strcmp(cmd, "dw") == 0 && args >= 2) {
+            remove_watchpoint(dbg, (uint16_t)a);
+        } else if (strcmp(cmd, "l") == 0) {
+            list_points(dbg);
+        } else if (strcmp(cmd, "r") == 0) {
+            dump_state(emu, stdout);
+        } else if (strcmp(cmd, "x") == 0 && args >= 2) {
+            hexdump(emu, a, args >= 3 ? b : 16);
+        } else if (strcmp(cmd, "t") == 0) {
+            set_trace(emu, !get_trace(emu));
+            printf("trace %s\n", get_trace(emu) ? "on" : "off");
+        } else if (strcmp(cmd, "q") == 0) {
+            return false;
+        } else {
+            help();
+        }
+    }
+}
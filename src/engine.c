@@ -0,0 +1,43 @@
+#include "../include/engine.h"
+#include "../include/helpers.h"
+#include "../include/quirks.h"
+#include <stdio.h>
+#include <string.h>
+
+static int run_reference(chip8 emu, int budget) {
+    for (int i = 0; i < budget; i++) {
+        tick(emu);
+    }
+    return budget;
+}
+
+static const struct engine ENGINES[] = {
+    { "reference", run_reference, true, true },
+    { "legacy", run_quirks_legacy, true, true },
+    { "fused", run_quirks_fused, true, true },
+    { "vip", run_quirks_vip, false, false },
+    { "chip48", run_quirks_chip48, false, false },
+    { "schip", run_quirks_schip, false, true },
+    { "xochip", run_quirks_xochip, false, true },
+};
+
+#define NUM_ENGINES (sizeof(ENGINES) / sizeof(ENGINES[0]))
+
+const struct engine* default_engine(void) {
+    return &ENGINES[0];
+}
+
+const struct engine* find_engine(const char* name) {
+    for (size_t i = 0; i < NUM_ENGINES; i++) {
+        if (strcmp(ENGINES[i].name, name) == 0) {
+            return &ENGINES[i];
+        }
+    }
+    return NULL;
+}
+
+void list_engines(FILE* out) {
+    for (size_t i = 0; i < NUM_ENGINES; i++) {
+        fprintf(out, "%s\n", ENGINES[i].name);
+    }
+}
@@ -7,98 +7,221 @@
 #include <string.h>
 #include <time.h>
 #include <math.h>
+#include "../include/catalog.h"
+#include "../include/hash.h"
+#include "../include/screen.h"
+#include "../include/engine.h"
+
+#define TRACE(emu, ...) do { if (get_trace(emu)) printf(__VA_ARGS__); } while (0)
 
 void keypress(chip8 emu, uint16_t index, bool pressed) {
     set_key(emu, pressed, index);
 }
 
-void load(chip8 emu, uint8_t* data, size_t size) {
+void load(chip8 emu, const uint8_t* data, size_t size) {
     if (size > (RAM_SIZE - START_ADDR)) {
         fprintf(stderr, "ROM size exceeds available memory\n");
         exit(EXIT_FAILURE);
     }
-    memcpy(get_ram_ptr(emu, START_ADDR), data, size);
+    set_ram_range(emu, data, START_ADDR, size);
 
     for (size_t i = START_ADDR; i < START_ADDR + size; i++) {
-        printf("RAM[%04X] = %02X\n", (unsigned int)i, get_ram(emu, i));
+        TRACE(emu, "RAM[%04X] = %02X\n", (unsigned int)i, get_ram(emu, i));
     }
 }
 
 void reset(chip8 emu) {
     set_pc(emu, START_ADDR);
-    for(int i = 0; i <= RAM_SIZE; ++i)
+    for(int i = 0; i < RAM_SIZE; ++i)
         set_ram(emu, 0, i);
-    for(int i = 0; i <= (SCREEN_WIDTH * SCREEN_HEIGHT); ++i)
-        set_screen(emu, false, i);
-    for(int i = 0; i <= NUM_REGS; ++i)
+    set_planes(emu, 0x1);
+    set_resolution(emu, false);
+    for(int i = 0; i < NUM_REGS; ++i)
+        set_rpl(emu, 0, i);
+    for(int i = 0; i < NUM_REGS; ++i)
         set_vreg(emu, 0, i);
     set_ireg(emu, 0);
     set_sp(emu, 0);
-    for(int i = 0; i <= STACK_SIZE; ++i)
+    for(int i = 0; i < STACK_SIZE; ++i)
         set_stack(emu, 0, i);
-    for(int i = 0; i <= NUM_KEYS; ++i)
+    for(int i = 0; i < NUM_KEYS; ++i)
         set_key(emu, false, i);
     set_dt(emu, 0);
     set_st(emu, 0);
+    set_cycles(emu, 0);
+    set_draws(emu, 0);
+    set_faults(emu, 0);
     
-    memcpy(get_ram_ptr(emu, 0), FONTSET, FONTSET_SIZE);
+    set_ram_range(emu, FONTSET, 0, FONTSET_SIZE);
+    set_ram_range(emu, BIGFONT, BIGFONT_ADDR, BIGFONT_SIZE);
+    invalidate_code(emu, 0, RAM_SIZE);
 }
 
+int load_rom(chip8 emu, const char* path) {
+    size_t size;
+    const uint8_t* rom = map_rom(path, &size);
+    if (!rom) {
+        return -1;
+    }
+    TRACE(emu, "rom size: %zu bytes\n", size);
+
+    if (size > (RAM_SIZE - START_ADDR)) {
+        fprintf(stderr, "%s: ROM size exceeds available memory\n", path);
+        unmap_rom(rom, size);
+        return -1;
+    }
+
+    load(emu, rom, size);
+    unmap_rom(rom, size);
+    return 0;
+}
+
+// SP itself is not bounded, the slot it picks wraps around the stack.
 void stack_push(chip8 emu, uint16_t value) {
-    set_stack(emu, value, get_sp(emu));
+    raise_fault(emu, FAULT_MASK(get_sp(emu) >= STACK_SIZE, FAULT_STACK_OVERFLOW));
+    set_stack(emu, value, get_sp(emu) & (STACK_SIZE - 1));
     set_sp(emu, get_sp(emu) + 1);
 }
 
 uint16_t stack_pop(chip8 emu) {
+    raise_fault(emu, FAULT_MASK(get_sp(emu) == 0, FAULT_STACK_UNDERFLOW));
     set_sp(emu, get_sp(emu) - 1);
-    return get_stack(emu, get_sp(emu));
+    return get_stack(emu, get_sp(emu) & (STACK_SIZE - 1));
+}
+
+// Raises FAULT_ADDRESS if `len` bytes at `addr` run off the end of RAM.
+static void check_span(chip8 emu, uint16_t addr, int len) {
+    raise_fault(emu, FAULT_MASK(addr + len > RAM_SIZE, FAULT_ADDRESS));
 }
 
 void tick(chip8 emu) {
+    uint8_t* map = get_coverage(emu);
+    if (map) {
+        map[get_pc(emu) >> 3] |= 1 << (get_pc(emu) & 7);
+    }
     uint16_t op = fetch(emu);
     execute(emu, op);
+    set_cycles(emu, get_cycles(emu) + 1);
+}
+
+void run_frame(chip8 emu) {
+    get_engine(emu)->run(emu, get_speed(emu));
+    tick_timer(emu);
+}
+
+uint8_t random_byte(chip8 emu) {
+    uint32_t r = get_rng(emu);
+    r ^= r << 13;
+    r ^= r >> 17;
+    r ^= r << 5;
+    set_rng(emu, r);
+    return (uint8_t)(r >> 24);
+}
+
+void pack_screen(chip8 emu, packed_screen* out) {
+    out->mode = get_hires(emu) ? SCREEN_HIRES : 0;
+    for (int p = 0; p < NUM_PLANES; p++) {
+        memcpy(out->rows[p], get_plane(emu, p), sizeof(out->rows[p]));
+    }
+    for (int i = 0; i < HIRES_HEIGHT * ROW_WORDS; i++) {
+        if (out->rows[1][0][i]) {
+            out->mode |= SCREEN_PLANE2;
+            break;
+        }
+    }
+}
+
+// A plain lo-res screen hashes the same 32 words it did before hi-res
+// support, so existing golden manifests stay valid.
+uint64_t hash_screen(chip8 emu) {
+    packed_screen screen;
+    pack_screen(emu, &screen);
+    if (screen.mode == 0) {
+        uint64_t rows[SCREEN_HEIGHT];
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            rows[y] = screen.rows[0][y][0];
+        }
+        return hash64(rows, sizeof(rows), 0);
+    }
+    return hash64(screen.rows, sizeof(screen.rows), screen.mode);
+}
+
+void dump_state(chip8 emu, FILE* out) {
+    fprintf(out, "PC=%04X I=%04X SP=%02X DT=%02X ST=%02X faults=%02X\n",
+            get_pc(emu), get_ireg(emu), get_sp(emu), get_dt(emu), get_st(emu), get_faults(emu));
+    for (int i = 0; i < NUM_REGS; i++) {
+        fprintf(out, "V%X=%02X%c", i, get_vreg(emu, i), i == NUM_REGS - 1 ? '\n' : ' ');
+    }
+    fprintf(out, "stack:");
+    for (int i = 0; i < get_sp(emu) && i < STACK_SIZE; i++) {
+        fprintf(out, " %04X", get_stack(emu, i));
+    }
+    fprintf(out, "\nram=%016llX screen=%016llX\n",
+            (unsigned long long)hash64(get_ram_ptr(emu, 0), RAM_SIZE, 0),
+            (unsigned long long)hash_screen(emu));
 }
 
 uint16_t fetch(chip8 emu) {
     uint16_t opcode = get_ram(emu, get_pc(emu)) << 8 | get_ram(emu, get_pc(emu) + 1);
-    printf("Fetched opcode: %04X at PC: %04X\n", opcode, get_pc(emu));
+    TRACE(emu, "Fetched opcode: %04X at PC: %04X\n", opcode, get_pc(emu));
     set_pc(emu, get_pc(emu) + 2);
     return opcode;
 }
 
 void tick_timer(chip8 emu) {
     if (get_dt(emu) > 0) {
-        printf("decrementing DT: %d\n", get_dt(emu));
+        TRACE(emu, "decrementing DT: %d\n", get_dt(emu));
         set_dt(emu, get_dt(emu) - 1);
     }
 
     if (get_st(emu) > 0) {
-        printf("decrementing ST: %d\n", get_st(emu)); 
+        TRACE(emu, "decrementing ST: %d\n", get_st(emu)); 
         if(get_st(emu) == 1) {
-            // do stuff
+            sound_edge(emu, false);
         }
         set_st(emu, get_st(emu) - 1);
     }
 }
 
+// DXYN, and DXY0 as a 16x16 sprite. With both XO-CHIP planes selected the
+// second plane's sprite follows the first in memory.
 void execute_draw(chip8 emu, uint8_t x_reg, uint8_t y_reg, uint8_t height) {
-    uint8_t x = get_vreg(emu, x_reg);
-    uint8_t y = get_vreg(emu, y_reg);
+    int w = screen_width(emu);
+    int h = screen_height(emu);
+    int x = get_vreg(emu, x_reg) % w;
+    int y = get_vreg(emu, y_reg) % h;
+    int wide = height == 0;
+    int rows = wide ? 16 : height;
+    uint16_t addr = get_ireg(emu);
+    int planes = (get_planes(emu) & 1) + (get_planes(emu) >> 1 & 1);
+    check_span(emu, addr, planes * rows * (wide ? 2 : 1));
     set_vreg(emu, 0, 0xF);
+    set_draws(emu, get_draws(emu) + 1);
 
-    for (uint8_t row = 0; row < height; ++row) {
-        uint8_t sprite = get_ram(emu, get_ireg(emu) + row);
-        for (uint8_t col = 0; col < 8; ++col) {
-            uint16_t idx = ((y + row) % SCREEN_HEIGHT) * SCREEN_WIDTH + ((x + col) % SCREEN_WIDTH);
-            bool sprite_pixel = (sprite & (0x80 >> col)) != 0;
-            if (sprite_pixel && get_screen(emu, idx)) {
+    for (int p = 0; p < NUM_PLANES; p++) {
+        if (!(get_planes(emu) & (1 << p))) {
+            continue;
+        }
+        uint64_t* plane = get_plane(emu, p);
+        for (int row = 0; row < rows; ++row) {
+            uint16_t bits = get_ram(emu, addr++) << 8;
+            if (wide) {
+                bits |= get_ram(emu, addr++);
+            }
+            if (xor_row(&plane[((y + row) % h) * ROW_WORDS], bits, x, w, true)) {
                 set_vreg(emu, 1, 0xF);
             }
-            set_screen(emu, get_screen(emu, idx) ^ sprite_pixel, idx);
         }
     }
 }
 
+// Skips the next instruction; XO-CHIP's F000 NNNN is two words long.
+static void skip(chip8 emu) {
+    uint16_t pc = get_pc(emu);
+    bool wide = get_ram(emu, pc) == 0xF0 && get_ram(emu, (uint16_t)(pc + 1)) == 0x00;
+    set_pc(emu, pc + (wide ? 4 : 2));
+}
+
 void execute(chip8 emu, uint16_t opcode) {
     uint8_t x = (opcode & 0x0F00) >> 8; // digit2
     uint8_t y = (opcode & 0x00F0) >> 4; // digit3
@@ -110,7 +233,6 @@ void execute(chip8 emu, uint16_t opcode) {
     bool borrow;
     uint8_t lsb;
     uint8_t msb;
-    uint8_t rng = rand() % 256;
     uint16_t vx;
     uint16_t key;
     bool pressed;
@@ -123,151 +245,207 @@ void execute(chip8 emu, uint16_t opcode) {
     switch (opcode >> 12) { // digit1
         case 0x0:
             if (opcode == 0x00E0) {
-                memset(get_display(emu), 0, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(bool));
-                printf("Screen cleared\n");
+                clear_screen(emu);
+                TRACE(emu, "Screen cleared\n");
             } else if (opcode == 0x00EE) {
                 uint16_t ret_addr = stack_pop(emu);
                 //emu->pc = ret_addr;
                 set_pc(emu, ret_addr); 
-                printf("Returned from subroutine\n");
+                TRACE(emu, "Returned from subroutine\n");
+            } else if ((opcode & 0xFFF0) == 0x00C0) {
+                scroll_down(emu, n);
+                TRACE(emu, "Scrolled down %d\n", n);
+            } else if ((opcode & 0xFFF0) == 0x00D0) {
+                scroll_up(emu, n);
+                TRACE(emu, "Scrolled up %d\n", n);
+            } else if (opcode == 0x00FB) {
+                scroll_right(emu);
+                TRACE(emu, "Scrolled right\n");
+            } else if (opcode == 0x00FC) {
+                scroll_left(emu);
+                TRACE(emu, "Scrolled left\n");
+            } else if (opcode == 0x00FD) {
+                // exit: stay on this instruction
+                set_pc(emu, get_pc(emu) - 2);
+                TRACE(emu, "Exited\n");
+            } else if (opcode == 0x00FE || opcode == 0x00FF) {
+                set_resolution(emu, opcode == 0x00FF);
+                TRACE(emu, "Set %s resolution\n", opcode == 0x00FF ? "high" : "low");
             } else {
-                printf("Unknown 0x0NNN opcode: 0x%04X\n", opcode);
+                raise_fault(emu, FAULT_OPCODE);
+                TRACE(emu, "Unknown 0x0NNN opcode: 0x%04X\n", opcode);
             }
             break;
         
         case 0x1:
             set_pc(emu, nnn); 
-            printf("Jumped\n");
+            TRACE(emu, "Jumped\n");
             break;
 
         case 0x2:
             stack_push(emu, get_pc(emu));
             set_pc(emu, nnn);
-            printf("Called subroutine\n");
+            TRACE(emu, "Called subroutine\n");
             break;
 
         case 0x3:
             if(get_vreg(emu, x) == nn) {
-                set_pc(emu, get_pc(emu) + 2);
+                skip(emu);
             }
-            printf("Skipped next VX == NN\n");
+            TRACE(emu, "Skipped next VX == NN\n");
             break;
 
         case 0x4:
             if(get_vreg(emu, x) != nn) {
-                set_pc(emu, get_pc(emu) + 2);
+                skip(emu);
             }
-            printf("Skipped next VX != NN\n");
+            TRACE(emu, "Skipped next VX != NN\n");
             break;
 
         case 0x5:
+            if(n == 0x2 || n == 0x3) {
+                // XO-CHIP: VX..VY to or from memory at I, in either order
+                int step = x <= y ? 1 : -1;
+                i = get_ireg(emu);
+                check_span(emu, i, (x <= y ? y - x : x - y) + 1);
+                for(int r = x; ; r += step, i++) {
+                    if(n == 0x2) {
+                        set_ram(emu, get_vreg(emu, r), i);
+                    } else {
+                        set_vreg(emu, get_ram(emu, i), r);
+                    }
+                    if(r == y) {
+                        break;
+                    }
+                }
+                TRACE(emu, "Did 5XY%X\n", n);
+                break;
+            }
             if(get_vreg(emu, x) == get_vreg(emu, y)) {
-                set_pc(emu, get_pc(emu) + 2);
+                skip(emu);
             }
-            printf("Skipped next VX == VY\n");
+            TRACE(emu, "Skipped next VX == VY\n");
             break;
 
         case 0x6:
             set_vreg(emu, nn, x);
-            printf("Set V%X = %02X\n", x, nn);
+            TRACE(emu, "Set V%X = %02X\n", x, nn);
             break;
 
         case 0x7:
             set_vreg(emu, get_vreg(emu, x) + nn, x); 
-            printf("Add %02X to V%X\n", nn, x);
+            TRACE(emu, "Add %02X to V%X\n", nn, x);
             break;
 
         case 0x8:
             if(n == 0x0) {
                 set_vreg(emu, get_vreg(emu, y), x); 
-                printf("Set VX = VY\n");
+                TRACE(emu, "Set VX = VY\n");
             } else if(n == 0x1) {
                 set_vreg(emu, get_vreg(emu, x) | get_vreg(emu, y), x); 
-                printf("Set VX |= VY\n");
+                TRACE(emu, "Set VX |= VY\n");
             } else if(n == 0x2) {
                 set_vreg(emu, get_vreg(emu, x) & get_vreg(emu, y), x); 
-                printf("Set VX &= VY\n");
+                TRACE(emu, "Set VX &= VY\n");
             } else if(n == 0x3) {
                 set_vreg(emu, get_vreg(emu, x) ^ get_vreg(emu, y), x); 
-                printf("Set VX ^= VY\n");
+                TRACE(emu, "Set VX ^= VY\n");
             } else if(n == 0x4) {
                 sum = get_vreg(emu, x) + get_vreg(emu, y);
                 set_vreg(emu, (uint8_t)sum, x);
                 set_vreg(emu, (sum > 255) ? 1 : 0, 0xF);
-                printf("Set VX += VY\n");
+                TRACE(emu, "Set VX += VY\n");
             } else if(n == 0x5) {
                 borrow = get_vreg(emu, x) < get_vreg(emu, y);
                 set_vreg(emu, get_vreg(emu, x) - get_vreg(emu, y), x);
                 set_vreg(emu, borrow ? 0 : 1, 0xF);
-                printf("Set VX -= VY\n");
+                TRACE(emu, "Set VX -= VY\n");
             } else if(n == 0x6) {
                 lsb = get_vreg(emu, x) & 1;
                 set_vreg(emu, get_vreg(emu, x) >> 1, x);
                 set_vreg(emu, lsb, 0xF);
-                printf("Set VX >>= 1\n");
+                TRACE(emu, "Set VX >>= 1\n");
             } else if(n == 0x7) {
                 borrow = get_vreg(emu, y) < get_vreg(emu, x);
                 set_vreg(emu, get_vreg(emu, y) - get_vreg(emu, x), x);
                 set_vreg(emu, borrow ? 0 : 1, 0xF);
-                printf("Set VX = VY - VX\n");
+                TRACE(emu, "Set VX = VY - VX\n");
             } else if(n == 0xE) {
                 msb = (get_vreg(emu, x) >> 7) & 1;
                 set_vreg(emu, get_vreg(emu, x) << 1, x);
                 set_vreg(emu, msb, 0xF);
-                printf("Set VX <<= 1\n");
+                TRACE(emu, "Set VX <<= 1\n");
+            } else {
+                raise_fault(emu, FAULT_OPCODE);
+                TRACE(emu, "Unknown 0x8XYN opcode: 0x%04X\n", opcode);
             }
             break;
         
         case 0x9:
             if(get_vreg(emu, x) != get_vreg(emu, y)) {
-                set_pc(emu, get_pc(emu) + 2);
+                skip(emu);
             } 
-            printf("Skipped next VX != VY\n");
+            TRACE(emu, "Skipped next VX != VY\n");
             break;
 
         case 0xA:
             set_ireg(emu, nnn);
-            printf("Set I = 0x%03X\n", nnn);
+            TRACE(emu, "Set I = 0x%03X\n", nnn);
             break;
         
         case 0xB:
             set_pc(emu, get_vreg(emu, 0) + nnn); 
-            printf("Jumps to address NNN + V0\n");
+            TRACE(emu, "Jumps to address NNN + V0\n");
             break;
 
         case 0xC:
-            set_vreg(emu, rng & nn, x); 
-            printf("Set VX = rand() & NN\n");
+            set_vreg(emu, random_byte(emu) & nn, x);
+            TRACE(emu, "Set VX = rand() & NN\n");
             break;
 
         case 0xD:
             execute_draw(emu, x, y, n);
-            printf("Draw sprite at V%X,V%X with height %X\n", x, y, n);
+            TRACE(emu, "Draw sprite at V%X,V%X with height %X\n", x, y, n);
             break;
             
         case 0xE:
             if(y == 0x9 && n == 0xE) {
                 vx = get_vreg(emu, x);
-                key = get_key(emu, vx);
+                raise_fault(emu, FAULT_MASK(vx >= NUM_KEYS, FAULT_KEY));
+                key = get_key(emu, vx & (NUM_KEYS - 1));
                 if(key) {
-                    set_pc(emu, get_pc(emu) + 2);
-                    printf("Skipped next key == VX\n");
+                    skip(emu);
+                    TRACE(emu, "Skipped next key == VX\n");
                 }
             } else if (y == 0xA && n == 0x1) {
                 vx = get_vreg(emu, x);
-                key = get_key(emu, vx);
+                raise_fault(emu, FAULT_MASK(vx >= NUM_KEYS, FAULT_KEY));
+                key = get_key(emu, vx & (NUM_KEYS - 1));
                 if(!key) {
-                    set_pc(emu, get_pc(emu) + 2);
-                    printf("Skipped next key != VX\n");
+                    skip(emu);
+                    TRACE(emu, "Skipped next key != VX\n");
                 }
+            } else {
+                raise_fault(emu, FAULT_OPCODE);
+                TRACE(emu, "Unknown 0xEXNN opcode: 0x%04X\n", opcode);
             }
             break;
 
         case 0xF:
-            if(y == 0x0 && n == 0x7) {
+            if(opcode == 0xF000) {
+                set_ireg(emu, get_ram(emu, get_pc(emu)) << 8 | get_ram(emu, (uint16_t)(get_pc(emu) + 1)));
+                set_pc(emu, get_pc(emu) + 2);
+                TRACE(emu, "Set I = 0x%04X\n", get_ireg(emu));
+            } else if(nn == 0x01) {
+                set_planes(emu, x & 0x3);
+                TRACE(emu, "Selected planes %X\n", x & 0x3);
+            } else if(opcode == 0xF002 || nn == 0x3A) {
+                // XO-CHIP audio pattern and pitch; the buzzer is a fixed tone
+                TRACE(emu, "Ignored audio opcode 0x%04X\n", opcode);
+            } else if(y == 0x0 && n == 0x7) {
                 //emu->v_reg[x] = emu->dt;
                 set_vreg(emu, get_dt(emu), x); 
-                printf("Set VX = DT\n");
+                TRACE(emu, "Set VX = DT\n");
             } else if(y == 0x0 && n == 0xA) {
                 pressed = false;
                 for(uint8_t i = 0; i < 16; i++) {
@@ -280,23 +458,30 @@ void execute(chip8 emu, uint16_t opcode) {
                 if(!pressed) {
                     set_pc(emu, get_pc(emu) - 2);
                 }
-                printf("Did FX0A\n");
+                TRACE(emu, "Did FX0A\n");
             } else if(y == 0x1 && n == 0x5) {
                 set_dt(emu, get_vreg(emu, x));
-                printf("Set DT = VX\n");
+                TRACE(emu, "Set DT = VX\n");
             } else if(y == 0x1 && n == 0x8) {
+                if((get_st(emu) > 0) != (get_vreg(emu, x) > 0)) {
+                    sound_edge(emu, get_vreg(emu, x) > 0);
+                }
                 set_st(emu, get_vreg(emu, x));
-                printf("Set ST = VX\n");
+                TRACE(emu, "Set ST = VX\n");
             } else if(y == 0x1 && n == 0xE) {
                 vx = get_vreg(emu, x);
                 set_ireg(emu, get_ireg(emu) + vx);
-                printf("Set I += VX\n");
+                TRACE(emu, "Set I += VX\n");
             } else if(y == 0x2 && n == 0x9) {
                 c = get_vreg(emu, x);
                 set_ireg(emu, c * 5);                
-                printf("Did FX29\n");
+                TRACE(emu, "Did FX29\n");
+            } else if(y == 0x3 && n == 0x0) {
+                set_ireg(emu, BIGFONT_ADDR + (get_vreg(emu, x) & 0xF) * 10);
+                TRACE(emu, "Did FX30\n");
             } else if(y == 0x3 && n == 0x3) {
                 vx = get_vreg(emu, x);
+                check_span(emu, get_ireg(emu), 3);
                 hundreds = floor((vx / 100));
                 tens = floor(vx / 10);
                 tens = tens % 10;
@@ -305,23 +490,38 @@ void execute(chip8 emu, uint16_t opcode) {
                 set_ram(emu, tens, get_ireg(emu) + 1); 
                 set_ram(emu, ones, get_ireg(emu) + 2); 
 
-                printf("Did FX33\n");
+                TRACE(emu, "Did FX33\n");
             } else if(y == 0x5 && n == 0x5) {
                 i = get_ireg(emu);
+                check_span(emu, i, x);
                 for(int idx = 0; idx < x; idx++) {
                     set_ram(emu, get_vreg(emu, idx), i + idx); 
                 }
-                printf("Did FX55\n");
+                TRACE(emu, "Did FX55\n");
             } else if(y == 0x6 && n == 0x5) {
                 i = get_ireg(emu);
+                check_span(emu, i, x);
                 for(int idx = 0; idx < x; idx++) {
                     set_vreg(emu, get_ram(emu, i + idx), idx); 
                 }
-                printf("Did FX65\n");
+                TRACE(emu, "Did FX65\n");
+            } else if(y == 0x7 && n == 0x5) {
+                for(int idx = 0; idx <= x; idx++) {
+                    set_rpl(emu, get_vreg(emu, idx), idx);
+                }
+                TRACE(emu, "Did FX75\n");
+            } else if(y == 0x8 && n == 0x5) {
+                for(int idx = 0; idx <= x; idx++) {
+                    set_vreg(emu, get_rpl(emu, idx), idx);
+                }
+                TRACE(emu, "Did FX85\n");
+            } else {
+                raise_fault(emu, FAULT_OPCODE);
+                TRACE(emu, "Unknown 0xFXNN opcode: 0x%04X\n", opcode);
             }
             break;
         default:
-            printf("Unhandled opcode: 0x%04X\n", opcode);
+            TRACE(emu, "Unhandled opcode: 0x%04X\n", opcode);
             break;
     }
 }
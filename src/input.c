@@ -0,0 +1,110 @@
+#include "../include/input.h"
+#include "../include/engine.h"
+#include "../include/helpers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    uint8_t key;
+    bool pressed;
+} key_event;
+
+struct input_queue_state {
+    key_event* events;
+    int count;
+    int cap;
+    uint16_t fresh; // keys pressed with no instruction run since
+};
+
+input_queue create_input_queue(void) {
+    input_queue q = (input_queue)malloc(sizeof(struct input_queue_state));
+    if (!q) {
+        fprintf(stderr, "Failed to allocate memory for input queue\n");
+        exit(EXIT_FAILURE);
+    }
+    q->cap = 16;
+    q->count = 0;
+    q->fresh = 0;
+    q->events = malloc((size_t)q->cap * sizeof(key_event));
+    if (!q->events) {
+        fprintf(stderr, "Failed to allocate memory for input queue\n");
+        exit(EXIT_FAILURE);
+    }
+    return q;
+}
+
+void destroy_input_queue(input_queue q) {
+    free(q->events);
+    free(q);
+}
+
+// Events have to arrive in time order, as SDL delivers them.
+void queue_key(input_queue q, uint8_t key, bool pressed) {
+    if (q->count == q->cap) {
+        q->cap *= 2;
+        q->events = realloc(q->events, (size_t)q->cap * sizeof(key_event));
+        if (!q->events) {
+            fprintf(stderr, "Failed to allocate memory for input queue\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    key_event* e = &q->events[q->count++];
+    e->key = key & (NUM_KEYS - 1);
+    e->pressed = pressed;
+}
+
+// Runs instructions up to `target`, counted from the start of the burst,
+// with the timers ticking at every frame boundary as in run_frame().
+static void run_until(chip8 emu, int* done, int target) {
+    int speed = get_speed(emu);
+    while (*done < target) {
+        int chunk = speed - *done % speed;
+        if (chunk > target - *done) {
+            chunk = target - *done;
+        }
+        get_engine(emu)->run(emu, chunk);
+        *done += chunk;
+        if (*done % speed == 0) {
+            tick_timer(emu);
+        }
+    }
+}
+
+// Applies the queued events, then runs a burst that has run `*done`
+// instructions on to `target`. A release whose press no instruction has
+// seen yet waits one instruction; if the slice has none left it stays
+// queued, with everything after it, for the next call.
+void run_queued(chip8 emu, input_queue q, int* done, int target) {
+    int i = 0;
+    for (; i < q->count; i++) {
+        const key_event* e = &q->events[i];
+        if (!e->pressed && ((q->fresh >> e->key) & 1)) {
+            if (*done >= target) {
+                break;
+            }
+            run_until(emu, done, *done + 1);
+            q->fresh = 0;
+        }
+        keypress(emu, e->key, e->pressed);
+        if (e->pressed) {
+            q->fresh |= (uint16_t)(1 << e->key);
+        }
+    }
+    if (*done < target) {
+        q->fresh = 0;
+    }
+    run_until(emu, done, target);
+    q->count -= i;
+    memmove(q->events, &q->events[i], (size_t)q->count * sizeof(key_event));
+}
+
+// Applies every queued event now, for callers that step the frame
+// themselves, such as the debugger.
+void flush_queued(chip8 emu, input_queue q) {
+    for (int i = 0; i < q->count; i++) {
+        keypress(emu, q->events[i].key, q->events[i].pressed);
+    }
+    q->count = 0;
+    q->fresh = 0;
+}
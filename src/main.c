@@ -4,45 +4,216 @@
 #include <SDL2/SDL_render.h>
 #include <stddef.h>
 #include <stdio.h>
+#include "../include/audio.h"
+#include "../include/catalog.h"
 #include "../include/chip8.h"
 #include "../include/helpers.h"
+#include "../include/input.h"
+#include "../include/metrics.h"
+#include "../include/scale.h"
+#include "../include/shm.h"
+#include "../include/debug.h"
+#include "../include/engine.h"
+#include "../include/wall.h"
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
 #include <SDL2/SDL_timer.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #define SCALE 15
 #define WIN_WIDTH SCREEN_WIDTH*SCALE
 #define WIN_HEIGHT SCREEN_HEIGHT*SCALE
+#define MAX_ROMS 64
+#define TURBO_FRAMES 10
+#define WALL_MAX_WIDTH 1920
+#define SPLASH_MS 3000
+// each frame's instructions run in slices spread over the frame, with the
+// keys polled before each one
+#define INPUT_SLICES 4
+#define FRAME_MS (1000 / 60)
 
-#define TICKS_PER_FRAME 10
+// opened only when a splash image is shown
+#ifndef SDL_IMAGE_LIB
+#define SDL_IMAGE_LIB "libSDL2_image-2.0.so.0"
+#endif
 
-void draw_test(SDL_Renderer*);
-uint16_t key2btn(SDL_Keycode);
+// Launch phases, reported with --timings.
+enum {
+    STARTUP_CATALOG,
+    STARTUP_SDL,
+    STARTUP_WINDOW,
+    STARTUP_RENDERER,
+    STARTUP_ROM,
+    STARTUP_AUDIO,
+    STARTUP_SETUP,
+    STARTUP_SPLASH,       // until the splash is first on screen
+    STARTUP_SPLASH_SHOWN, // while it stays there, left out of the launch time
+    STARTUP_FIRST_FRAME,
+    NUM_STARTUP,
+};
+
+static const char* STARTUP_NAMES[NUM_STARTUP] = {
+    "catalog", "SDL init", "window", "renderer", "ROM load", "audio", "setup", "splash", "splash shown",
+    "first frame",
+};
+
+typedef struct {
+    Uint64 last;
+    double ms[NUM_STARTUP];
+    bool splashed;
+    bool done;
+} startup_timer;
+
+// --splash: the image is decoded on its own thread while the rest starts
+// up, then shown until SPLASH_MS pass or a key is pressed. The emulator
+// waits behind it.
+typedef struct {
+    const char* path;
+    SDL_Thread* thread;
+    SDL_atomic_t ready;
+    SDL_Surface* surface;
+    void* image_lib;
+    SDL_Texture* texture;
+    Uint32 until;
+    bool active;
+} splash_screen;
+
+typedef SDL_Surface* (*img_load_fn)(const char*);
+
+void startup_mark(startup_timer*, int);
+void startup_report(const startup_timer*, FILE*);
+void startup_splashed(startup_timer*, bool);
+void startup_presented(startup_timer*, bool);
+int load_splash(void*);
+void start_splash(splash_screen*, const char*);
+bool show_splash(splash_screen*, SDL_Renderer*);
+void end_splash(splash_screen*);
+int key2btn(SDL_Keycode);
+void poll_keys(input_queue);
 void draw_screen(chip8, SDL_Renderer*);
+void draw_scaled(chip8, SDL_Renderer*, scaler, SDL_Texture**);
+void usage(const char*);
+void audio_callback(void*, Uint8*, int);
+int run_wall(const char**, int, int, const struct engine*);
+void release_keys(chip8);
+void report_faults(chip8, const char*, uint8_t*);
+
+// Ends the current phase, which started where the previous one ended. A
+// phase can be split, the parts add up.
+void startup_mark(startup_timer* t, int phase) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    t->ms[phase] += (double)(now - t->last) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+    t->last = now;
+}
+
+void startup_report(const startup_timer* t, FILE* out) {
+    double total = 0;
+    fprintf(out, "startup:");
+    for (int i = 0; i < NUM_STARTUP; i++) {
+        fprintf(out, " %s %.1f ms,", STARTUP_NAMES[i], t->ms[i]);
+        total += t->ms[i];
+    }
+    fprintf(out, " total %.1f ms, launch %.1f ms\n", total, total - t->ms[STARTUP_SPLASH_SHOWN]);
+}
 
-void draw_test(SDL_Renderer* renderer) {
-    SDL_Surface* image_surface = IMG_Load("../img/51Y6ShMGJHL._AC_UF894,1000_QL80_.jpg");
-    if (!image_surface) {
-        fprintf(stderr, "Failed to load image: %s\n", IMG_GetError());
+// Called after every present of the splash, blank until `image` is decoded.
+void startup_splashed(startup_timer* t, bool image) {
+    if (t->done) {
         return;
     }
-    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, image_surface);
-    SDL_FreeSurface(image_surface);
-    if (!texture) {
-        fprintf(stderr, "Failed to create texture: %s\n", SDL_GetError());
+    startup_mark(t, t->splashed ? STARTUP_SPLASH_SHOWN : STARTUP_SPLASH);
+    t->splashed = image;
+}
+
+// Called after every present of an emulated frame; the first one ends
+// startup.
+void startup_presented(startup_timer* t, bool report) {
+    if (t->done) {
+        return;
+    }
+    startup_mark(t, STARTUP_FIRST_FRAME);
+    t->done = true;
+    if (report) {
+        startup_report(t, stderr);
+    }
+}
+
+int load_splash(void* data) {
+    splash_screen* s = (splash_screen*)data;
+    // SDL_image is only needed here; without it BMPs still load
+    s->image_lib = SDL_LoadObject(SDL_IMAGE_LIB);
+    img_load_fn img_load = s->image_lib ? (img_load_fn)SDL_LoadFunction(s->image_lib, "IMG_Load") : NULL;
+    s->surface = img_load ? img_load(s->path) : SDL_LoadBMP(s->path);
+    if (!s->surface) {
+        fprintf(stderr, "Failed to load splash %s: %s\n", s->path, SDL_GetError());
+    }
+    SDL_AtomicSet(&s->ready, 1);
+    return 0;
+}
+
+void start_splash(splash_screen* s, const char* path) {
+    memset(s, 0, sizeof(*s));
+    if (!path) {
         return;
     }
+    s->path = path;
+    s->active = true;
+    s->thread = SDL_CreateThread(load_splash, "splash", s);
+    if (!s->thread) {
+        fprintf(stderr, "Splash thread could not be created! SDL_Error: %s\n", SDL_GetError());
+        s->active = false;
+    }
+}
+
+// Draws the splash, or black while it is still decoding. Returns false
+// once it is over.
+bool show_splash(splash_screen* s, SDL_Renderer* renderer) {
+    if (!s->active) {
+        return false;
+    }
+    if (!s->texture && SDL_AtomicGet(&s->ready)) {
+        if (s->surface) {
+            s->texture = SDL_CreateTextureFromSurface(renderer, s->surface);
+            SDL_FreeSurface(s->surface);
+            s->surface = NULL;
+        }
+        if (!s->texture) {
+            s->active = false;
+            return false;
+        }
+        s->until = SDL_GetTicks() + SPLASH_MS;
+    }
+    if (s->texture && SDL_GetTicks() >= s->until) {
+        s->active = false;
+        return false;
+    }
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
     SDL_RenderClear(renderer);
-    SDL_RenderCopy(renderer, texture, NULL, NULL);
-    SDL_RenderPresent(renderer);
-    SDL_Delay(3000);
-    SDL_DestroyTexture(texture);
+    if (s->texture) {
+        SDL_RenderCopy(renderer, s->texture, NULL, NULL);
+    }
+    return true;
+}
+
+void end_splash(splash_screen* s) {
+    if (s->thread) {
+        SDL_WaitThread(s->thread, NULL);
+    }
+    if (s->surface) {
+        SDL_FreeSurface(s->surface);
+    }
+    if (s->texture) {
+        SDL_DestroyTexture(s->texture);
+    }
+    if (s->image_lib) {
+        SDL_UnloadObject(s->image_lib);
+    }
 }
 
-uint16_t key2btn(SDL_Keycode key) {
+// The CHIP-8 key for a keyboard key, or -1.
+int key2btn(SDL_Keycode key) {
     switch(key) {
         case SDLK_1: return 0x1;
         case SDLK_2: return 0x2;
@@ -64,38 +235,386 @@ uint16_t key2btn(SDL_Keycode key) {
     }
 }
 
+// Queues the CHIP-8 key events that arrived since the last poll. Stops at
+// any other key press, which the main event loop handles in order at the
+// start of the next frame.
+void poll_keys(input_queue pending) {
+    SDL_Event event;
+    SDL_PumpEvents();
+    while (SDL_PeepEvents(&event, 1, SDL_PEEKEVENT, SDL_KEYDOWN, SDL_KEYUP) == 1) {
+        int key = key2btn(event.key.keysym.sym);
+        if (key == -1 && event.type == SDL_KEYDOWN) {
+            break;
+        }
+        SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_KEYDOWN, SDL_KEYUP);
+        if (key != -1) {
+            queue_key(pending, (uint8_t)key, event.type == SDL_KEYDOWN);
+        }
+    }
+}
+
 void draw_screen(chip8 emu, SDL_Renderer* renderer) {
-    bool* screen_buf = get_display(emu);
+    // plane 1, plane 2, both
+    static const SDL_Color colors[3] = {
+        {255, 255, 255, SDL_ALPHA_OPAQUE}, {255, 102, 0, SDL_ALPHA_OPAQUE}, {102, 34, 0, SDL_ALPHA_OPAQUE},
+    };
+    packed_screen screen;
+    pack_screen(emu, &screen);
+    int width = PACKED_WIDTH(&screen);
+    int cell = WIN_WIDTH / width;
     int active_pixels = 0;
 
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
     SDL_RenderClear(renderer);
 
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, SDL_ALPHA_OPAQUE);
-
-    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++) {
-        if (screen_buf[i]) {
+    for (int i = 0; i < width * PACKED_HEIGHT(&screen); i++) {
+        int x = i % width;
+        int y = i / width;
+        int bit = 63 - x % 64;
+        int lit = (int)((screen.rows[0][y][x / 64] >> bit) & 1)
+            | (int)((screen.rows[1][y][x / 64] >> bit) & 1) << 1;
+        if (lit) {
             active_pixels++;
-            int x = (i % SCREEN_WIDTH) * SCALE;
-            int y = (i / SCREEN_WIDTH) * SCALE;
-            SDL_Rect rect = {x, y, SCALE, SCALE};
+            SDL_SetRenderDrawColor(renderer, colors[lit - 1].r, colors[lit - 1].g, colors[lit - 1].b, SDL_ALPHA_OPAQUE);
+            SDL_Rect rect = {x * cell, y * cell, cell, cell};
             SDL_RenderFillRect(renderer, &rect);
         }
     }
-    printf("Active pixels: %d\n", active_pixels);
-    SDL_RenderPresent(renderer);
+    if (get_trace(emu)) {
+        printf("Active pixels: %d\n", active_pixels);
+    }
+}
+
+// The scaler's output follows the ROM's resolution; the texture is
+// recreated when it changes.
+void draw_scaled(chip8 emu, SDL_Renderer* renderer, scaler s, SDL_Texture** texture) {
+    const uint32_t* pixels = scale_frame(s, emu);
+    int w, h;
+    SDL_QueryTexture(*texture, NULL, NULL, &w, &h);
+    if (w != scaler_width(s) || h != scaler_height(s)) {
+        SDL_Texture* resized = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                                 scaler_width(s), scaler_height(s));
+        if (!resized) {
+            fprintf(stderr, "Texture could not be created! SDL_Error: %s\n", SDL_GetError());
+            return;
+        }
+        SDL_DestroyTexture(*texture);
+        *texture = resized;
+    }
+    SDL_UpdateTexture(*texture, NULL, pixels, scaler_width(s) * sizeof(uint32_t));
+    SDL_RenderCopy(renderer, *texture, NULL, NULL);
+}
+
+void audio_callback(void* userdata, Uint8* stream, int len) {
+    audio_render((audio)userdata, (int16_t*)stream, len / (int)sizeof(int16_t));
+}
+
+// Prints each kind of fault the ROM raises the first time it shows up.
+void report_faults(chip8 emu, const char* name, uint8_t* reported) {
+    uint8_t raised = get_faults(emu) & ~*reported;
+    for (int bit = 1; bit <= FAULT_OPCODE; bit <<= 1) {
+        if (raised & bit) {
+            fprintf(stderr, "%s: %s\n", name, fault_name((uint8_t)bit));
+        }
+    }
+    *reported |= raised;
+}
+
+// --wall: `count` instances of the given ROMs, round robin, in one window.
+// Keys go to the focused tile; Tab or a click moves the focus.
+// Called on the tile losing focus, so no key it held sticks.
+void release_keys(chip8 emu) {
+    for (int k = 0; k < NUM_KEYS; k++) {
+        keypress(emu, k, false);
+    }
+}
+
+int run_wall(const char** roms, int nroms, int count, const struct engine* quirks) {
+    chip8* emus = malloc((size_t)count * sizeof(chip8));
+    if (!emus) {
+        fprintf(stderr, "Failed to allocate memory for wall\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < count; i++) {
+        emus[i] = init_emulator();
+        // distinct random streams, or every copy of a game plays the same
+        set_rng(emus[i], ((uint32_t)time(NULL) ^ (uint32_t)i * 0x9E3779B9u) | 1);
+        if (quirks) {
+            set_engine(emus[i], quirks);
+        }
+        if (load_rom(emus[i], roms[i % nroms]) != 0) {
+            for (int j = 0; j <= i; j++) {
+                destroy_emulator(emus[j]);
+            }
+            free(emus);
+            return EXIT_FAILURE;
+        }
+    }
+    wall tiles = create_wall(emus, count, 0);
+
+    int zoom = WALL_MAX_WIDTH / wall_width(tiles);
+    if (zoom < 1) {
+        zoom = 1;
+    }
+    SDL_Window* window = SDL_CreateWindow("CHIP8 WALL", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                                          wall_width(tiles) * zoom, wall_height(tiles) * zoom, SDL_WINDOW_SHOWN);
+    SDL_Renderer* renderer = window ? SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC) : NULL;
+    SDL_Texture* texture = renderer ? SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                                        wall_width(tiles), wall_height(tiles)) : NULL;
+    int status = EXIT_SUCCESS;
+    if (!texture) {
+        fprintf(stderr, "Wall could not be created! SDL_Error: %s\n", SDL_GetError());
+        status = EXIT_FAILURE;
+    }
+
+    int focus = 0;
+    bool running = texture != NULL;
+    SDL_Event event;
+    while (running) {
+        while (SDL_PollEvent(&event)) {
+            switch (event.type) {
+                case SDL_QUIT:
+                    running = false;
+                    break;
+                case SDL_MOUSEBUTTONDOWN: {
+                    int tile = wall_tile_at(tiles, event.button.x / zoom, event.button.y / zoom);
+                    if (tile >= 0 && tile != focus) {
+                        release_keys(emus[focus]);
+                        focus = tile;
+                    }
+                    break;
+                }
+                case SDL_KEYDOWN:
+                    if (event.key.keysym.sym == SDLK_ESCAPE) {
+                        running = false;
+                    } else if (event.key.keysym.sym == SDLK_TAB) {
+                        release_keys(emus[focus]);
+                        focus = (focus + 1) % count;
+                    } else {
+                        int key = key2btn(event.key.keysym.sym);
+                        if (key != -1) {
+                            keypress(emus[focus], key, true);
+                        }
+                    }
+                    break;
+                case SDL_KEYUP: {
+                    int key = key2btn(event.key.keysym.sym);
+                    if (key != -1) {
+                        keypress(emus[focus], key, false);
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+
+        for (int i = 0; i < count; i++) {
+            run_frame(emus[i]);
+        }
+
+        // upload only the bands of rows that changed, then one copy
+        wall_render(tiles);
+        const uint32_t* pixels = wall_pixels(tiles);
+        int pitch = wall_width(tiles) * (int)sizeof(uint32_t);
+        int rows;
+        for (int y = wall_dirty(tiles, 0, &rows); y >= 0; y = wall_dirty(tiles, y + rows, &rows)) {
+            SDL_Rect band = { 0, y, wall_width(tiles), rows };
+            SDL_UpdateTexture(texture, &band, pixels + (size_t)y * wall_width(tiles), pitch);
+        }
+        SDL_RenderCopy(renderer, texture, NULL, NULL);
+
+        int fx, fy;
+        wall_tile_origin(tiles, focus, &fx, &fy);
+        SDL_Rect outline = { fx * zoom, fy * zoom, WALL_TILE_WIDTH * zoom, WALL_TILE_HEIGHT * zoom };
+        SDL_SetRenderDrawColor(renderer, 255, 255, 0, SDL_ALPHA_OPAQUE);
+        SDL_RenderDrawRect(renderer, &outline);
+        SDL_RenderPresent(renderer);
+    }
+
+    if (texture) {
+        SDL_DestroyTexture(texture);
+    }
+    if (renderer) {
+        SDL_DestroyRenderer(renderer);
+    }
+    if (window) {
+        SDL_DestroyWindow(window);
+    }
+    destroy_wall(tiles);
+    for (int i = 0; i < count; i++) {
+        destroy_emulator(emus[i]);
+    }
+    free(emus);
+    return status;
+}
+
+void usage(const char* prog) {
+    printf("Usage: %s [options] path/to/game [more/games with --wall]\n", prog);
+    printf("  --catalog INDEX                look the game up in a ROM catalog by hash prefix or title\n");
+    printf("  --wall N                       run N instances of one or more games in a grid, Tab or click to focus\n");
+    printf("  --quirks PROFILE               legacy, fused, vip, chip48, schip or xochip (default: the reference interpreter)\n");
+    printf("  --filter none|scale2x|scale3x  software scaling filter\n");
+    printf("  --phosphor N                   phosphor decay per frame, 0-255\n");
+    printf("  --shm NAME                     publish frames to POSIX shared memory NAME\n");
+    printf("  --debug                        start in the debugger, F12 breaks in later\n");
+    printf("  --audio-buffer N               audio device buffer in samples (default 256)\n");
+    printf("  --wav PATH                     write the buzzer to a WAV file instead of the device\n");
+    printf("  --mute                         no sound\n");
+    printf("  --metrics ADDR                 serve Prometheus metrics on unix:/path or [host:]port\n");
+    printf("  --metrics-json PATH            write metrics as JSON to PATH every second\n");
+    printf("  --turbo N                      frames emulated per frame shown while Tab turbo is on (default %d)\n", TURBO_FRAMES);
+    printf("  --splash PATH                  show an image (BMP, or anything SDL_image reads) before the game\n");
+    printf("  --timings                      print how long each launch phase took\n");
+    printf("  --trace                        log every instruction and the loaded ROM\n");
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        printf("Usage: %s path/to/game\n", argv[0]);
+    const char* rom_path = NULL;
+    const char* roms[MAX_ROMS];
+    int nroms = 0;
+    int wall_count = 0;
+    bool use_scaler = false;
+    scale_filter filter = FILTER_NONE;
+    int decay = 0;
+    const char* shm_name = NULL;
+    bool debug = false;
+    int audio_buffer = 256;
+    const char* wav_path = NULL;
+    bool mute = false;
+    const char* metrics_addr = NULL;
+    const char* metrics_json = NULL;
+    const char* catalog_path = NULL;
+    const struct engine* quirks = NULL;
+    int turbo = TURBO_FRAMES;
+    const char* splash_path = NULL;
+    bool timings = false;
+    bool trace = false;
+    startup_timer startup;
+    memset(&startup, 0, sizeof(startup));
+    startup.last = SDL_GetPerformanceCounter();
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            if (parse_filter(argv[++i], &filter) != 0) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            use_scaler = true;
+        } else if (strcmp(argv[i], "--phosphor") == 0 && i + 1 < argc) {
+            decay = atoi(argv[++i]);
+            if (decay < 0 || decay > 255) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            use_scaler = true;
+        } else if (strcmp(argv[i], "--shm") == 0 && i + 1 < argc) {
+            shm_name = argv[++i];
+        } else if (strcmp(argv[i], "--debug") == 0) {
+            debug = true;
+        } else if (strcmp(argv[i], "--audio-buffer") == 0 && i + 1 < argc) {
+            audio_buffer = atoi(argv[++i]);
+            if (audio_buffer <= 0 || audio_buffer > 8192) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--wav") == 0 && i + 1 < argc) {
+            wav_path = argv[++i];
+        } else if (strcmp(argv[i], "--mute") == 0) {
+            mute = true;
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metrics_addr = argv[++i];
+        } else if (strcmp(argv[i], "--metrics-json") == 0 && i + 1 < argc) {
+            metrics_json = argv[++i];
+        } else if (strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+            quirks = find_engine(argv[++i]);
+            if (!quirks) {
+                fprintf(stderr, "Unknown quirk profile: %s\n", argv[i]);
+                list_engines(stderr);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--catalog") == 0 && i + 1 < argc) {
+            catalog_path = argv[++i];
+        } else if (strcmp(argv[i], "--turbo") == 0 && i + 1 < argc) {
+            turbo = atoi(argv[++i]);
+            if (turbo < 1 || turbo > 1000) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--splash") == 0 && i + 1 < argc) {
+            splash_path = argv[++i];
+        } else if (strcmp(argv[i], "--timings") == 0) {
+            timings = true;
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            trace = true;
+        } else if (strcmp(argv[i], "--wall") == 0 && i + 1 < argc) {
+            wall_count = atoi(argv[++i]);
+            if (wall_count <= 0) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (argv[i][0] == '-' || nroms == MAX_ROMS) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        } else {
+            roms[nroms++] = argv[i];
+        }
+    }
+    // several games only make sense on a wall
+    if (nroms == 0 || (nroms > 1 && !wall_count) || (wall_count && (catalog_path || debug))) {
+        usage(argv[0]);
         return EXIT_FAILURE;
     }
+    rom_path = roms[0];
+
+    if (wall_count) {
+        if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+            fprintf(stderr, "SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
+            return EXIT_FAILURE;
+        }
+        int status = run_wall(roms, nroms, wall_count, quirks);
+        SDL_Quit();
+        return status;
+    }
 
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+    catalog library = NULL;
+    const catalog_entry* entry = NULL;
+    if (catalog_path) {
+        library = open_catalog(catalog_path);
+        if (!library) {
+            fprintf(stderr, "%s: cannot open catalog\n", catalog_path);
+            return EXIT_FAILURE;
+        }
+        int found = catalog_find(library, rom_path, 0);
+        if (found < 0) {
+            fprintf(stderr, "%s: no ROM matches \"%s\"\n", catalog_path, rom_path);
+            close_catalog(library);
+            return EXIT_FAILURE;
+        }
+        entry = catalog_at(library, found);
+        // the catalog's profile for this ROM, unless one was asked for
+        const char* profile = catalog_string(library, entry->quirks);
+        if (!profile[0] && entry->platform == PLATFORM_SCHIP) {
+            profile = "schip";
+        } else if (!profile[0] && entry->platform == PLATFORM_XOCHIP) {
+            profile = "xochip";
+        }
+        if (!quirks && profile[0]) {
+            quirks = find_engine(profile);
+            if (!quirks) {
+                fprintf(stderr, "%s: unknown quirk profile %s, using the default\n", catalog_path, profile);
+            }
+        }
+    }
+
+    startup_mark(&startup, STARTUP_CATALOG);
+
+    // the audio subsystem is slow to start and only the device needs it
+    if (SDL_Init(SDL_INIT_VIDEO | (mute || wav_path ? 0 : SDL_INIT_AUDIO)) < 0) {
         fprintf(stderr, "SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
         return EXIT_FAILURE;
     }
+    startup_mark(&startup, STARTUP_SDL);
 
     SDL_Window *window = SDL_CreateWindow(
         "CHIP8 EMU",
@@ -110,6 +629,7 @@ int main(int argc, char* argv[]) {
         SDL_Quit();
         return EXIT_FAILURE;
     }
+    startup_mark(&startup, STARTUP_WINDOW);
 
     SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
     if (!renderer) {
@@ -119,76 +639,163 @@ int main(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
 
-    draw_test(renderer);
+    startup_mark(&startup, STARTUP_RENDERER);
 
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
-    SDL_RenderClear(renderer);
-    SDL_RenderPresent(renderer);
+    splash_screen splash;
+    start_splash(&splash, splash_path);
 
     SDL_Event event;
 
     chip8 emu = init_emulator();
-    printf("Checking loaded fontset...\n");
-    for (int i = 0; i < FONTSET_SIZE; i++) {
-        printf("Font[%02X] = %02X\n", i, get_ram(emu, i));
+    set_trace(emu, trace);
+    if (trace) {
+        printf("Checking loaded fontset...\n");
+        for (int i = 0; i < FONTSET_SIZE; i++) {
+            printf("Font[%02X] = %02X\n", i, get_ram(emu, i));
+        }
     }
 
-    FILE* rom = fopen(argv[1], "rb");
-    if (!rom) {
-        perror("Unable to open file");
+    int loaded = entry ? load_catalog_rom(emu, library, entry) : load_rom(emu, rom_path);
+    const char* title = entry ? catalog_string(library, entry->title) : "CHIP8 EMU";
+    if (entry) {
+        SDL_SetWindowTitle(window, title);
+    }
+    if (quirks) {
+        set_engine(emu, quirks);
+    }
+    if (loaded != 0) {
+        end_splash(&splash);
+        destroy_emulator(emu);
+        if (library) {
+            close_catalog(library);
+        }
         SDL_DestroyRenderer(renderer);
         SDL_DestroyWindow(window);
         SDL_Quit();
         return EXIT_FAILURE;
     }
+    for (size_t i = START_ADDR; i < START_ADDR + 16 && trace; i++) {
+        printf("RAM[%04X] = %02X\n", (unsigned int)i, get_ram(emu, i));
+    }
+    startup_mark(&startup, STARTUP_ROM);
 
-    fseek(rom, 0, SEEK_END);
-    size_t rom_size = ftell(rom);
-    printf("rom size: %zu bytes\n", rom_size);
-    rewind(rom);
+    scaler output = NULL;
+    SDL_Texture* texture = NULL;
+    if (use_scaler) {
+        output = create_scaler(filter, (uint8_t)decay, 0xFFFFFF, 0x000000);
+        texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                    scaler_width(output), scaler_height(output));
+        if (!texture) {
+            fprintf(stderr, "Texture could not be created! SDL_Error: %s\n", SDL_GetError());
+            destroy_scaler(output);
+            output = NULL;
+        }
+    }
 
-    uint8_t *buffer = (uint8_t *)malloc(rom_size);
-    if (!buffer) {
-        fprintf(stderr, "Failed to allocate memory for ROM\n");
-        fclose(rom);
-        SDL_DestroyRenderer(renderer);
-        SDL_DestroyWindow(window);
-        SDL_Quit();
-        return EXIT_FAILURE;
+    shm_publisher publisher = NULL;
+    if (shm_name) {
+        publisher = create_publisher(shm_name);
     }
 
-    fread(buffer, 1, rom_size, rom);
-    fclose(rom);
+    startup_mark(&startup, STARTUP_SETUP);
 
-    load(emu, buffer, rom_size);
-    for (size_t i = START_ADDR; i < START_ADDR + 16; i++) {
-        printf("RAM[%04X] = %02X\n", (unsigned int)i, get_ram(emu, i));
+    audio sound = NULL;
+    SDL_AudioDeviceID device = 0;
+    if (!mute) {
+        sound = create_audio(AUDIO_RATE, audio_buffer);
+        if (wav_path) {
+            if (open_wav(sound, wav_path) != 0) {
+                destroy_audio(sound);
+                sound = NULL;
+            }
+        } else {
+            SDL_AudioSpec want;
+            SDL_AudioSpec have;
+            SDL_zero(want);
+            want.freq = AUDIO_RATE;
+            want.format = AUDIO_S16SYS;
+            want.channels = 1;
+            want.samples = (Uint16)audio_buffer;
+            want.callback = audio_callback;
+            want.userdata = sound;
+            device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+            if (!device) {
+                // no device: keep running silently rather than failing
+                fprintf(stderr, "Audio device could not be opened! SDL_Error: %s\n", SDL_GetError());
+                destroy_audio(sound);
+                sound = NULL;
+            }
+        }
+        if (sound) {
+            attach_audio(sound, emu);
+        }
+        if (device) {
+            SDL_PauseAudioDevice(device, 0);
+        }
     }
 
-    free(buffer);
+    startup_mark(&startup, STARTUP_AUDIO);
+
+    metrics stats = NULL;
+    metrics_server stats_server = NULL;
+    if (metrics_addr || metrics_json) {
+        stats = create_metrics("main");
+        set_metrics_dump(stats, metrics_json);
+    }
+    if (metrics_addr) {
+        stats_server = create_metrics_server(metrics_addr);
+        if (stats_server) {
+            register_metrics(stats_server, stats);
+        }
+    }
 
+    debugger dbg = NULL;
+    if (debug) {
+        dbg = create_debugger();
+        debug_break(dbg);
+    }
+
+    startup_mark(&startup, STARTUP_SETUP);
+
+    uint64_t frame = 0;
     bool running = true;
+    bool turbo_on = false;
+    uint8_t reported = 0;
+    // key events polled but not applied yet
+    input_queue pending = create_input_queue();
     while (running) {
-        printf("RUNNING MAIN LOOP...\n");
+        Uint32 frame_start = SDL_GetTicks();
+        if (trace) {
+            printf("RUNNING MAIN LOOP...\n");
+        }
         while (SDL_PollEvent(&event)) {
             switch (event.type) {
                 case SDL_QUIT:
                     running = false;
                     break;
                 case SDL_KEYDOWN:
-                    if (event.key.keysym.sym == SDLK_ESCAPE) {
+                    if (splash.active) {
+                        splash.active = false;
+                    } else if (event.key.keysym.sym == SDLK_ESCAPE) {
                         running = false;
+                    } else if (event.key.keysym.sym == SDLK_F12 && dbg) {
+                        debug_break(dbg);
+                    } else if (event.key.keysym.sym == SDLK_TAB && !event.key.repeat) {
+                        turbo_on = !turbo_on;
+                        char caption[256];
+                        snprintf(caption, sizeof(caption), turbo_on ? "%s [turbo x%d]" : "%s", title, turbo);
+                        SDL_SetWindowTitle(window, caption);
                     } else {
                         int key = key2btn(event.key.keysym.sym);
                         if (key != -1) {
-                            keypress(emu, key, true);
+                            queue_key(pending, (uint8_t)key, true);
                         }
                     }
                     break;
                 case SDL_KEYUP: {
                     int key = key2btn(event.key.keysym.sym);
                     if (key != -1) {
-                        keypress(emu, key, false);
+                        queue_key(pending, (uint8_t)key, false);
                     }
                     break;
                 }
@@ -196,21 +803,113 @@ int main(int argc, char* argv[]) {
                     break;
             }
         }
+        if (stats_server) {
+            metrics_serve(stats_server);
+        }
+        if (stats) {
+            metrics_mark(stats, PHASE_POLL);
+        }
+        if (show_splash(&splash, renderer)) {
+            flush_queued(emu, pending);
+            SDL_RenderPresent(renderer);
+            startup_splashed(&startup, splash.texture != NULL);
+            continue;
+        }
+
+        // turbo runs several frames, timers included, per frame shown;
+        // the ones in between are never drawn
+        int frames = 1;
+        if (dbg && debug_armed(dbg)) {
+            if (debug_paused(dbg) && !debug_repl(dbg, emu, stdin)) {
+                break;
+            }
+            flush_queued(emu, pending);
+            debug_frame(dbg, emu);
+        } else {
+            frames = turbo_on ? turbo : 1;
+            int budget = frames * get_speed(emu);
+            int done = 0;
+            for (int slice = 1; slice <= INPUT_SLICES; slice++) {
+                if (slice > 1) {
+                    Uint32 due = frame_start + (Uint32)(slice - 1) * FRAME_MS / INPUT_SLICES;
+                    Uint32 now = SDL_GetTicks();
+                    if ((Sint32)(due - now) > 0) {
+                        if (stats) {
+                            metrics_mark(stats, PHASE_TICK);
+                        }
+                        SDL_Delay(due - now);
+                        if (stats) {
+                            metrics_mark(stats, PHASE_IDLE);
+                        }
+                    }
+                    poll_keys(pending);
+                }
+                run_queued(emu, pending, &done, budget * slice / INPUT_SLICES);
+            }
+        }
+        report_faults(emu, entry ? title : rom_path, &reported);
+        if (sound) {
+            audio_pump(sound, emu);
+        }
+        if (stats) {
+            metrics_mark(stats, PHASE_TICK);
+        }
 
-        for (int i = 0; i < TICKS_PER_FRAME; i++) {
-            tick(emu);
+        if (output) {
+            draw_scaled(emu, renderer, output, &texture);
+        } else {
+            draw_screen(emu, renderer);
         }
+        if (publisher) {
+            publish_frame(publisher, emu, frame);
+        }
+        if (stats) {
+            metrics_mark(stats, PHASE_DRAW);
+        }
+        // with vsync this is where the frame waits
+        SDL_RenderPresent(renderer);
+        startup_presented(&startup, timings);
+        if (stats) {
+            metrics_mark(stats, PHASE_IDLE);
+            metrics_frame(stats, emu);
+        }
+        frame += frames;
+    }
 
-        tick_timer(emu);
+    destroy_input_queue(pending);
+    if (publisher) {
+        destroy_publisher(publisher);
+    }
+    if (stats_server) {
+        destroy_metrics_server(stats_server);
+    }
+    if (stats) {
+        destroy_metrics(stats);
+    }
+    if (device) {
+        SDL_CloseAudioDevice(device);
+    }
+    if (sound) {
+        destroy_audio(sound);
+    }
+    if (dbg) {
+        destroy_debugger(dbg);
+    }
 
-        draw_screen(emu, renderer);
+    if (output) {
+        SDL_DestroyTexture(texture);
+        destroy_scaler(output);
     }
+    end_splash(&splash);
 
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
     
     destroy_emulator(emu);
+    if (library) {
+        close_catalog(library);
+    }
 
     return EXIT_SUCCESS;
 }
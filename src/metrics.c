@@ -0,0 +1,440 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/metrics.h"
+#include "../include/net.h"
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SUB_BUCKETS 8
+#define HIST_BUCKETS (62 * SUB_BUCKETS)
+#define WINDOW_NS 1000000000ull
+#define MAX_INSTANCES 16
+#define MAX_PENDING 8
+#define REQUEST_SIZE 1024
+
+static const char* PHASE_NAMES[PHASE_COUNT] = { "poll", "tick", "draw", "idle" };
+
+typedef struct {
+    uint64_t buckets[HIST_BUCKETS];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+} histogram;
+
+// Rates over the last complete window, in thousandths.
+typedef enum {
+    RATE_FPS,
+    RATE_IPS,
+    RATE_DRAWS_PER_FRAME,
+    RATE_IDLE,
+    RATE_COUNT
+} rate;
+
+struct metrics_state {
+    char name[32];
+    uint64_t frames;
+    uint64_t instructions;
+    uint64_t draws;
+    histogram phases[PHASE_COUNT];
+    uint64_t rates[RATE_COUNT];
+
+    // owner-only bookkeeping, never read by the server
+    uint64_t last_mark;
+    uint64_t last_cycles;
+    uint64_t last_draws;
+    uint64_t window_start;
+    uint64_t window_frames;
+    uint64_t window_instructions;
+    uint64_t window_draws;
+    uint64_t window_idle;
+    char* dump_path;
+};
+
+typedef struct {
+    int fd;
+    char request[REQUEST_SIZE];
+    size_t len;
+} pending;
+
+struct metrics_server_state {
+    int listen_fd;
+    char unix_path[108];
+    metrics instances[MAX_INSTANCES];
+    int count;
+    pending clients[MAX_PENDING];
+    int npending;
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Single writer: a relaxed load and store, no locked read-modify-write.
+static void add(uint64_t* counter, uint64_t n) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+static void put(uint64_t* counter, uint64_t value) {
+    __atomic_store_n(counter, value, __ATOMIC_RELAXED);
+}
+
+static uint64_t get(const uint64_t* counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+static int bucket_of(uint64_t v) {
+    if (v < SUB_BUCKETS) {
+        return (int)v;
+    }
+    int e = 63 - __builtin_clzll(v);
+    return (e - 2) * SUB_BUCKETS + (int)((v >> (e - 3)) & (SUB_BUCKETS - 1));
+}
+
+// Smallest value that falls in the next bucket.
+static uint64_t bucket_limit(int b) {
+    b++;
+    if (b < SUB_BUCKETS) {
+        return (uint64_t)b;
+    }
+    int e = b / SUB_BUCKETS + 2;
+    return (uint64_t)(SUB_BUCKETS + b % SUB_BUCKETS) << (e - 3);
+}
+
+static void record(histogram* h, uint64_t v) {
+    add(&h->buckets[bucket_of(v)], 1);
+    add(&h->count, 1);
+    add(&h->sum, v);
+    if (v > get(&h->max)) {
+        put(&h->max, v);
+    }
+}
+
+static uint64_t quantile(const histogram* h, double q) {
+    uint64_t count = get(&h->count);
+    if (!count) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(q * (double)(count - 1)) + 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += get(&h->buckets[b]);
+        if (seen >= rank) {
+            // middle of the bucket, so the error is at most half its width
+            uint64_t low = b ? bucket_limit(b - 1) : 0;
+            uint64_t mid = low + (bucket_limit(b) - low) / 2;
+            uint64_t max = get(&h->max);
+            return mid < max ? mid : max;
+        }
+    }
+    return get(&h->max);
+}
+
+metrics create_metrics(const char* name) {
+    metrics m = (metrics)calloc(1, sizeof(struct metrics_state));
+    if (!m) {
+        fprintf(stderr, "Failed to allocate memory for metrics\n");
+        exit(EXIT_FAILURE);
+    }
+    snprintf(m->name, sizeof(m->name), "%s", name);
+    m->last_mark = now_ns();
+    m->window_start = m->last_mark;
+    return m;
+}
+
+// Writes the JSON for `m` to `path` about once a second.
+void set_metrics_dump(metrics m, const char* path) {
+    free(m->dump_path);
+    m->dump_path = path ? strdup(path) : NULL;
+}
+
+// Charges the time since the previous mark to `phase`.
+void metrics_mark(metrics m, metrics_phase phase) {
+    uint64_t now = now_ns();
+    uint64_t elapsed = now - m->last_mark;
+    m->last_mark = now;
+    record(&m->phases[phase], elapsed);
+    if (phase == PHASE_IDLE) {
+        m->window_idle += elapsed;
+    }
+}
+
+static void dump(metrics m) {
+    size_t len = strlen(m->dump_path);
+    char* tmp = (char*)malloc(len + 5);
+    if (!tmp) {
+        fprintf(stderr, "Failed to allocate memory for metrics dump\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(tmp, m->dump_path, len);
+    memcpy(tmp + len, ".tmp", 5);
+    // write aside and rename, so readers never see half a file
+    FILE* out = fopen(tmp, "w");
+    if (!out) {
+        perror(tmp);
+    } else {
+        write_json(&m, 1, out);
+        fclose(out);
+        if (rename(tmp, m->dump_path) != 0) {
+            perror(m->dump_path);
+        }
+    }
+    free(tmp);
+}
+
+// Writes a last dump, so a run shorter than a window still leaves one.
+void destroy_metrics(metrics m) {
+    if (m->dump_path) {
+        dump(m);
+    }
+    free(m->dump_path);
+    free(m);
+}
+
+// Called once per frame by the owning thread, after the frame has run.
+void metrics_frame(metrics m, chip8 emu) {
+    uint64_t cycles = get_cycles(emu);
+    uint64_t draws = get_draws(emu);
+    // reset() restarts the emulator's counters; ours keep counting
+    if (cycles < m->last_cycles || draws < m->last_draws) {
+        m->last_cycles = 0;
+        m->last_draws = 0;
+    }
+    uint64_t instructions = cycles - m->last_cycles;
+    uint64_t drawn = draws - m->last_draws;
+    m->last_cycles = cycles;
+    m->last_draws = draws;
+
+    add(&m->frames, 1);
+    add(&m->instructions, instructions);
+    add(&m->draws, drawn);
+    m->window_frames++;
+    m->window_instructions += instructions;
+    m->window_draws += drawn;
+
+    uint64_t elapsed = m->last_mark - m->window_start;
+    if (elapsed < WINDOW_NS) {
+        return;
+    }
+    double scale = 1000.0 * (double)WINDOW_NS / (double)elapsed;
+    put(&m->rates[RATE_FPS], (uint64_t)((double)m->window_frames * scale));
+    put(&m->rates[RATE_IPS], (uint64_t)((double)m->window_instructions * scale));
+    put(&m->rates[RATE_DRAWS_PER_FRAME], m->window_draws * 1000 / m->window_frames);
+    put(&m->rates[RATE_IDLE], m->window_idle * 1000 / elapsed);
+
+    m->window_start = m->last_mark;
+    m->window_frames = 0;
+    m->window_instructions = 0;
+    m->window_draws = 0;
+    m->window_idle = 0;
+    if (m->dump_path) {
+        dump(m);
+    }
+}
+
+static double milli(const metrics m, rate r) {
+    return (double)get(&m->rates[r]) / 1000.0;
+}
+
+static double seconds(uint64_t ns) {
+    return (double)ns / 1e9;
+}
+
+static const double QUANTILES[] = { 0.5, 0.9, 0.99 };
+#define NUM_QUANTILES (sizeof(QUANTILES) / sizeof(QUANTILES[0]))
+
+// Counters are exported as they are, gauges from their thousandths.
+typedef struct {
+    const char* name;
+    const char* help;
+    bool gauge;
+    size_t offset;
+} series;
+
+#define RATE_OFFSET(r) (offsetof(struct metrics_state, rates) + (r) * sizeof(uint64_t))
+
+static const series SERIES[] = {
+    { "chip8_frames_total", "Frames emulated.", false, offsetof(struct metrics_state, frames) },
+    { "chip8_instructions_total", "Instructions executed.", false, offsetof(struct metrics_state, instructions) },
+    { "chip8_draws_total", "DXYN sprite draws executed.", false, offsetof(struct metrics_state, draws) },
+    { "chip8_frames_per_second", "Frame rate over the last second.", true, RATE_OFFSET(RATE_FPS) },
+    { "chip8_instructions_per_second", "Instruction rate over the last second.", true, RATE_OFFSET(RATE_IPS) },
+    { "chip8_draws_per_frame", "DXYN draws per frame over the last second.", true, RATE_OFFSET(RATE_DRAWS_PER_FRAME) },
+    { "chip8_idle_ratio", "Fraction of the last second spent waiting.", true, RATE_OFFSET(RATE_IDLE) },
+};
+#define NUM_SERIES (sizeof(SERIES) / sizeof(SERIES[0]))
+
+void write_prometheus(metrics* list, int n, FILE* out) {
+    for (size_t k = 0; k < NUM_SERIES; k++) {
+        const series* se = &SERIES[k];
+        fprintf(out, "# HELP %s %s\n# TYPE %s %s\n", se->name, se->help, se->name,
+                se->gauge ? "gauge" : "counter");
+        for (int i = 0; i < n; i++) {
+            uint64_t v = get((const uint64_t*)((const char*)list[i] + se->offset));
+            if (se->gauge) {
+                fprintf(out, "%s{emulator=\"%s\"} %.3f\n", se->name, list[i]->name, (double)v / 1000.0);
+            } else {
+                fprintf(out, "%s{emulator=\"%s\"} %llu\n", se->name, list[i]->name, (unsigned long long)v);
+            }
+        }
+    }
+
+    fprintf(out, "# HELP chip8_phase_seconds Time spent per frame in each phase.\n");
+    fprintf(out, "# TYPE chip8_phase_seconds summary\n");
+    for (int i = 0; i < n; i++) {
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            const histogram* h = &list[i]->phases[p];
+            for (size_t q = 0; q < NUM_QUANTILES; q++) {
+                fprintf(out, "chip8_phase_seconds{emulator=\"%s\",phase=\"%s\",quantile=\"%g\"} %.9f\n",
+                        list[i]->name, PHASE_NAMES[p], QUANTILES[q], seconds(quantile(h, QUANTILES[q])));
+            }
+            fprintf(out, "chip8_phase_seconds_sum{emulator=\"%s\",phase=\"%s\"} %.9f\n",
+                    list[i]->name, PHASE_NAMES[p], seconds(get(&h->sum)));
+            fprintf(out, "chip8_phase_seconds_count{emulator=\"%s\",phase=\"%s\"} %llu\n",
+                    list[i]->name, PHASE_NAMES[p], (unsigned long long)get(&h->count));
+        }
+    }
+    fprintf(out, "# HELP chip8_phase_max_seconds Longest single frame phase.\n");
+    fprintf(out, "# TYPE chip8_phase_max_seconds gauge\n");
+    for (int i = 0; i < n; i++) {
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            fprintf(out, "chip8_phase_max_seconds{emulator=\"%s\",phase=\"%s\"} %.9f\n",
+                    list[i]->name, PHASE_NAMES[p], seconds(get(&list[i]->phases[p].max)));
+        }
+    }
+}
+
+void write_json(metrics* list, int n, FILE* out) {
+    fprintf(out, "{\"emulators\":[");
+    for (int i = 0; i < n; i++) {
+        metrics m = list[i];
+        fprintf(out, "%s{\"name\":\"%s\",\"frames\":%llu,\"instructions\":%llu,\"draws\":%llu,",
+                i ? "," : "", m->name, (unsigned long long)get(&m->frames),
+                (unsigned long long)get(&m->instructions), (unsigned long long)get(&m->draws));
+        fprintf(out, "\"fps\":%.3f,\"mips\":%.6f,\"draws_per_frame\":%.3f,\"idle_ratio\":%.3f,\"phases\":{",
+                milli(m, RATE_FPS), milli(m, RATE_IPS) / 1e6, milli(m, RATE_DRAWS_PER_FRAME), milli(m, RATE_IDLE));
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            const histogram* h = &m->phases[p];
+            uint64_t count = get(&h->count);
+            fprintf(out, "%s\"%s\":{\"count\":%llu,\"mean_us\":%.3f,\"p50_us\":%.3f,\"p90_us\":%.3f,\"p99_us\":%.3f,\"max_us\":%.3f}",
+                    p ? "," : "", PHASE_NAMES[p], (unsigned long long)count,
+                    count ? (double)get(&h->sum) / (double)count / 1e3 : 0.0,
+                    (double)quantile(h, 0.5) / 1e3, (double)quantile(h, 0.9) / 1e3,
+                    (double)quantile(h, 0.99) / 1e3, (double)get(&h->max) / 1e3);
+        }
+        fprintf(out, "}}");
+    }
+    fprintf(out, "]}\n");
+}
+
+metrics_server create_metrics_server(const char* addr) {
+    metrics_server server = (metrics_server)calloc(1, sizeof(struct metrics_server_state));
+    if (!server) {
+        fprintf(stderr, "Failed to allocate memory for metrics server\n");
+        exit(EXIT_FAILURE);
+    }
+    server->listen_fd = open_socket(addr, true, server->unix_path);
+    if (server->listen_fd < 0 || set_nonblocking(server->listen_fd) != 0) {
+        if (server->listen_fd >= 0) {
+            close(server->listen_fd);
+        }
+        free(server);
+        return NULL;
+    }
+    return server;
+}
+
+void destroy_metrics_server(metrics_server server) {
+    for (int i = 0; i < server->npending; i++) {
+        close(server->clients[i].fd);
+    }
+    close(server->listen_fd);
+    if (server->unix_path[0]) {
+        unlink(server->unix_path);
+    }
+    free(server);
+}
+
+void register_metrics(metrics_server server, metrics m) {
+    if (server->count == MAX_INSTANCES) {
+        fprintf(stderr, "metrics: too many instances, %s not exported\n", m->name);
+        return;
+    }
+    server->instances[server->count++] = m;
+}
+
+static void respond(metrics_server server, pending* client) {
+    char* body = NULL;
+    size_t body_len = 0;
+    FILE* out = open_memstream(&body, &body_len);
+    if (!out) {
+        return;
+    }
+    const char* status = "200 OK";
+    const char* type = "text/plain; version=0.0.4";
+    if (strncmp(client->request, "GET /metrics ", 13) == 0) {
+        write_prometheus(server->instances, server->count, out);
+    } else if (strncmp(client->request, "GET /json ", 10) == 0) {
+        write_json(server->instances, server->count, out);
+        type = "application/json";
+    } else {
+        status = "404 Not Found";
+        fprintf(out, "try /metrics or /json\n");
+    }
+    fclose(out);
+
+    char header[160];
+    int header_len = snprintf(header, sizeof(header),
+        "HTTP/1.0 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+        status, type, body_len);
+    // small enough for the socket buffer; a scraper that cannot take it
+    // in one go gets a truncated response rather than stalling the frame
+    send(client->fd, header, (size_t)header_len, MSG_NOSIGNAL);
+    send(client->fd, body, body_len, MSG_NOSIGNAL);
+    free(body);
+}
+
+static void drop_client(metrics_server server, int i) {
+    close(server->clients[i].fd);
+    server->clients[i] = server->clients[--server->npending];
+}
+
+// Accepts scrapers and answers the ones whose request has arrived. Never
+// blocks; call it once per frame.
+void metrics_serve(metrics_server server) {
+    int fd;
+    while ((fd = accept(server->listen_fd, NULL, NULL)) >= 0) {
+        if (server->npending == MAX_PENDING || set_nonblocking(fd) != 0) {
+            close(fd);
+            continue;
+        }
+        server->clients[server->npending].fd = fd;
+        server->clients[server->npending].len = 0;
+        server->npending++;
+    }
+
+    for (int i = 0; i < server->npending; i++) {
+        pending* client = &server->clients[i];
+        ssize_t n = recv(client->fd, client->request + client->len,
+                         sizeof(client->request) - 1 - client->len, 0);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            continue;
+        }
+        if (n <= 0) {
+            drop_client(server, i--);
+            continue;
+        }
+        client->len += (size_t)n;
+        client->request[client->len] = '\0';
+        // only the request line matters
+        if (strstr(client->request, "\r\n\r\n") || client->len == sizeof(client->request) - 1) {
+            respond(server, client);
+            drop_client(server, i--);
+        }
+    }
+}
@@ -0,0 +1,99 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/net.h"
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// Opens a listening (server) or connected (client) socket for `addr`.
+int open_socket(const char* addr, bool server, char* unix_path) {
+    if (strncmp(addr, "unix:", 5) == 0) {
+        struct sockaddr_un sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        if (strlen(addr + 5) >= sizeof(sa.sun_path)) {
+            fprintf(stderr, "%s: socket path too long\n", addr);
+            return -1;
+        }
+        strcpy(sa.sun_path, addr + 5);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            perror("socket");
+            return -1;
+        }
+        if (server) {
+            unlink(sa.sun_path);
+            if (bind(fd, (struct sockaddr*)&sa, sizeof(sa)) != 0 || listen(fd, 4) != 0) {
+                perror(addr);
+                close(fd);
+                return -1;
+            }
+            strcpy(unix_path, sa.sun_path);
+        } else if (connect(fd, (struct sockaddr*)&sa, sizeof(sa)) != 0) {
+            perror(addr);
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    char host[256] = "127.0.0.1";
+    const char* port = addr;
+    const char* colon = strrchr(addr, ':');
+    if (colon) {
+        size_t len = (size_t)(colon - addr);
+        if (len >= sizeof(host)) {
+            len = sizeof(host) - 1;
+        }
+        memcpy(host, addr, len);
+        host[len] = '\0';
+        port = colon + 1;
+    }
+
+    struct addrinfo hints;
+    struct addrinfo* res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &res) != 0) {
+        fprintf(stderr, "%s: cannot resolve\n", addr);
+        return -1;
+    }
+
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd < 0) {
+        perror("socket");
+        freeaddrinfo(res);
+        return -1;
+    }
+    int one = 1;
+    if (server) {
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, res->ai_addr, res->ai_addrlen) != 0 || listen(fd, 4) != 0) {
+            perror(addr);
+            close(fd);
+            fd = -1;
+        }
+    } else {
+        if (connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+            perror(addr);
+            close(fd);
+            fd = -1;
+        } else {
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+    }
+    freeaddrinfo(res);
+    return fd;
+}
@@ -0,0 +1,81 @@
+#include "../include/quirks.h"
+#include "../include/chip8_impl.h"
+#include "../include/helpers.h"
+#include "../include/screen.h"
+#include <string.h>
+
+// One interpreter per quirk profile, stamped out from interp.inc.
+
+// The behaviour of execute() as it stands, including FX55/FX65 stopping one
+// register short. Kept so the lockstep tool can hold the template to the
+// reference interpreter.
+#define PROFILE legacy
+#define SHIFT_VY 0
+#define MEMORY_I 0
+#define MEMORY_SHORT 1
+#define JUMP_VX 0
+#define CLIP_SPRITES 0
+#define VF_RESET 0
+#define EXTENDED 2
+#define FUSE 0
+#include "interp.inc"
+
+// The same with superinstructions; lockstep holds it to the reference too.
+#define PROFILE fused
+#define SHIFT_VY 0
+#define MEMORY_I 0
+#define MEMORY_SHORT 1
+#define JUMP_VX 0
+#define CLIP_SPRITES 0
+#define VF_RESET 0
+#define EXTENDED 2
+#define FUSE 1
+#include "interp.inc"
+
+// The original COSMAC VIP interpreter.
+#define PROFILE vip
+#define SHIFT_VY 1
+#define MEMORY_I 1
+#define MEMORY_SHORT 0
+#define JUMP_VX 0
+#define CLIP_SPRITES 1
+#define VF_RESET 1
+#define EXTENDED 0
+#define FUSE 1
+#include "interp.inc"
+
+// CHIP-48 on the HP-48: in-place shifts, I advanced by X, BXNN.
+#define PROFILE chip48
+#define SHIFT_VY 0
+#define MEMORY_I 2
+#define MEMORY_SHORT 0
+#define JUMP_VX 1
+#define CLIP_SPRITES 1
+#define VF_RESET 0
+#define EXTENDED 0
+#define FUSE 1
+#include "interp.inc"
+
+// SUPER-CHIP 1.1: as CHIP-48 but I is left alone.
+#define PROFILE schip
+#define SHIFT_VY 0
+#define MEMORY_I 0
+#define MEMORY_SHORT 0
+#define JUMP_VX 1
+#define CLIP_SPRITES 1
+#define VF_RESET 0
+#define EXTENDED 1
+#define FUSE 1
+#include "interp.inc"
+
+// XO-CHIP: the VIP's shift and memory behaviour on the extended machine.
+#define PROFILE xochip
+#define SHIFT_VY 1
+#define MEMORY_I 1
+#define MEMORY_SHORT 0
+#define JUMP_VX 0
+#define CLIP_SPRITES 1
+#define VF_RESET 0
+#define EXTENDED 2
+#define FUSE 1
+#include "interp.inc"
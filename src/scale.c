@@ -0,0 +1,299 @@
+#include "../include/scale.h"
+#include "../include/helpers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// The framebuffer is 1 bit per pixel, so the Scale2x/Scale3x rules reduce
+// to boolean algebra. Each row is ROW_WORDS 64-bit words (MSB = leftmost
+// pixel; lo-res uses the first word) and the filters are evaluated a word
+// at a time, with the neighbour shifts carrying across words; only the
+// final expansion to bytes is per pixel. The phosphor
+// blend runs on one intensity byte per output pixel and plane, 16 at a time
+// with SSE2. A second XO-CHIP plane is filtered and faded on its own and
+// the two intensities pick from a 16x16 colour table.
+
+// second plane and overlap colours, as in Octo
+#define PLANE2_COLOR 0xFF6600u
+#define BLEND_COLOR 0x662200u
+
+struct scaler_state {
+    scale_filter filter;
+    int factor;
+    int width;
+    int height;
+    uint8_t mode;
+    bool colour; // plane 2 has been drawn on since the last mode switch
+    uint8_t decay;
+    uint8_t* level[NUM_PLANES];
+    uint8_t* fresh[NUM_PLANES];
+    uint32_t* pixels;
+    uint32_t palette[256];
+    uint32_t palette2[256]; // plane 1 level >> 4, plane 2 level >> 4
+};
+
+static int filter_factor(scale_filter filter) {
+    switch (filter) {
+        case FILTER_SCALE2X: return 2;
+        case FILTER_SCALE3X: return 3;
+        default: return 1;
+    }
+}
+
+int parse_filter(const char* name, scale_filter* filter) {
+    if (strcmp(name, "none") == 0) {
+        *filter = FILTER_NONE;
+    } else if (strcmp(name, "scale2x") == 0 || strcmp(name, "epx") == 0) {
+        *filter = FILTER_SCALE2X;
+    } else if (strcmp(name, "scale3x") == 0) {
+        *filter = FILTER_SCALE3X;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+static uint8_t lerp(uint32_t a, uint32_t b, int shift, int t) {
+    int ca = (a >> shift) & 0xFF;
+    int cb = (b >> shift) & 0xFF;
+    return (uint8_t)(cb + (ca - cb) * t / 255);
+}
+
+scaler create_scaler(scale_filter filter, uint8_t decay, uint32_t fg, uint32_t bg) {
+    scaler s = (scaler)malloc(sizeof(struct scaler_state));
+    if (!s) {
+        fprintf(stderr, "Failed to allocate memory for scaler\n");
+        exit(EXIT_FAILURE);
+    }
+    s->filter = filter;
+    s->factor = filter_factor(filter);
+    s->width = SCREEN_WIDTH * s->factor;
+    s->height = SCREEN_HEIGHT * s->factor;
+    s->mode = 0;
+    s->colour = false;
+    s->decay = decay;
+
+    // sized for hi-res; lo-res frames use the front of each buffer
+    size_t n = (size_t)HIRES_WIDTH * HIRES_HEIGHT * s->factor * s->factor;
+    for (int p = 0; p < NUM_PLANES; p++) {
+        s->level[p] = calloc(n, 1);
+        s->fresh[p] = calloc(n, 1);
+        if (!s->level[p] || !s->fresh[p]) {
+            fprintf(stderr, "Failed to allocate memory for scaler\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    s->pixels = calloc(n, sizeof(uint32_t));
+    if (!s->pixels) {
+        fprintf(stderr, "Failed to allocate memory for scaler\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int t = 0; t < 256; t++) {
+        s->palette[t] = 0xFF000000u
+            | (uint32_t)lerp(fg, bg, 16, t) << 16
+            | (uint32_t)lerp(fg, bg, 8, t) << 8
+            | (uint32_t)lerp(fg, bg, 0, t);
+    }
+    // bilinear between bg, fg, plane 2 and overlap
+    for (int a = 0; a < 16; a++) {
+        for (int b = 0; b < 16; b++) {
+            uint32_t c = 0xFF000000u;
+            for (int shift = 0; shift < 24; shift += 8) {
+                uint32_t lo = lerp(fg, bg, shift, a * 17);
+                uint32_t hi = lerp(BLEND_COLOR, PLANE2_COLOR, shift, a * 17);
+                c |= (uint32_t)lerp(hi, lo, 0, b * 17) << shift;
+            }
+            s->palette2[a << 4 | b] = c;
+        }
+    }
+    return s;
+}
+
+void destroy_scaler(scaler s) {
+    for (int p = 0; p < NUM_PLANES; p++) {
+        free(s->level[p]);
+        free(s->fresh[p]);
+    }
+    free(s->pixels);
+    free(s);
+}
+
+int scaler_width(scaler s) {
+    return s->width;
+}
+
+int scaler_height(scaler s) {
+    return s->height;
+}
+
+// Neighbours of word `k` of a row, with the edge pixel repeated as in the
+// reference Scale2x. `last` is the bit of the rightmost pixel at the
+// current width, in whichever word holds it; pixels past it are zero.
+static uint64_t left_of(const uint64_t* w, int k) {
+    return (w[k] >> 1) | (k ? w[k - 1] << 63 : w[0] & ((uint64_t)1 << 63));
+}
+
+static uint64_t right_of(const uint64_t* w, int k, const uint64_t* last) {
+    return (w[k] << 1) | (k + 1 < ROW_WORDS ? w[k + 1] >> 63 : 0) | (w[k] & last[k]);
+}
+
+static uint64_t eq(uint64_t a, uint64_t b) {
+    return ~(a ^ b);
+}
+
+static uint64_t pick(uint64_t mask, uint64_t a, uint64_t b) {
+    return (mask & a) | (~mask & b);
+}
+
+// Writes the `count` sub-pixel rows of the `n` pixels in one word, each
+// interleaving `count` words per x.
+static void expand(uint8_t* out, const uint64_t* sub, int count, int n) {
+    for (int x = 0; x < n; x++) {
+        int bit = 63 - x;
+        for (int j = 0; j < count; j++) {
+            out[x * count + j] = (uint8_t)-(int)((sub[j] >> bit) & 1);
+        }
+    }
+}
+
+static void filter_rows(scaler s, const uint64_t (*plane)[ROW_WORDS], uint8_t* fresh) {
+    int k = s->factor;
+    int stride = s->width;
+    int width = s->width / k;
+    int height = s->height / k;
+    int words = (width + 63) / 64;
+    uint64_t last[ROW_WORDS] = { 0 };
+    uint64_t rows[HIRES_HEIGHT][ROW_WORDS];
+
+    last[(width - 1) / 64] = (uint64_t)1 << (63 - (width - 1) % 64);
+    for (int y = 0; y < height; y++) {
+        for (int w = 0; w < ROW_WORDS; w++) {
+            int n = width - 64 * w;
+            rows[y][w] = n >= 64 ? plane[y][w] : n > 0 ? plane[y][w] & ~(uint64_t)0 << (64 - n) : 0;
+        }
+    }
+
+    for (int y = 0; y < height; y++) {
+        const uint64_t* above = rows[y > 0 ? y - 1 : y];
+        const uint64_t* row = rows[y];
+        const uint64_t* below = rows[y < height - 1 ? y + 1 : y];
+
+        for (int w = 0; w < words; w++) {
+            uint64_t e = row[w];
+            uint64_t b = above[w];
+            uint64_t h = below[w];
+            uint64_t d = left_of(row, w);
+            uint64_t f = right_of(row, w, last);
+            int n = width - 64 * w < 64 ? width - 64 * w : 64;
+            uint8_t* out = &fresh[(size_t)y * k * stride + (size_t)w * 64 * k];
+            uint64_t sub[3];
+
+            if (k == 1) {
+                expand(out, &e, 1, n);
+                continue;
+            }
+
+            uint64_t active = ~eq(b, h) & ~eq(d, f);
+
+            if (k == 2) {
+                sub[0] = pick(active & eq(d, b), d, e);
+                sub[1] = pick(active & eq(b, f), f, e);
+                expand(out, sub, 2, n);
+                sub[0] = pick(active & eq(d, h), d, e);
+                sub[1] = pick(active & eq(h, f), f, e);
+                expand(out + stride, sub, 2, n);
+                continue;
+            }
+
+            uint64_t a = left_of(above, w);
+            uint64_t c = right_of(above, w, last);
+            uint64_t g = left_of(below, w);
+            uint64_t i = right_of(below, w, last);
+            uint64_t db = eq(d, b);
+            uint64_t bf = eq(b, f);
+            uint64_t dh = eq(d, h);
+            uint64_t hf = eq(h, f);
+
+            sub[0] = pick(active & db, d, e);
+            sub[1] = pick(active & ((db & ~eq(e, c)) | (bf & ~eq(e, a))), b, e);
+            sub[2] = pick(active & bf, f, e);
+            expand(out, sub, 3, n);
+            sub[0] = pick(active & ((db & ~eq(e, g)) | (dh & ~eq(e, a))), d, e);
+            sub[1] = e;
+            sub[2] = pick(active & ((bf & ~eq(e, i)) | (hf & ~eq(e, c))), f, e);
+            expand(out + stride, sub, 3, n);
+            sub[0] = pick(active & dh, d, e);
+            sub[1] = pick(active & ((dh & ~eq(e, i)) | (hf & ~eq(e, g))), h, e);
+            sub[2] = pick(active & hf, f, e);
+            expand(out + 2 * stride, sub, 3, n);
+        }
+    }
+}
+
+// level = max(fresh, level * decay / 256)
+static void persist(scaler s, uint8_t* level, const uint8_t* fresh) {
+    size_t n = (size_t)s->width * s->height;
+    size_t i = 0;
+
+    if (s->decay == 0) {
+        memcpy(level, fresh, n);
+        return;
+    }
+
+#ifdef __SSE2__
+    __m128i zero = _mm_setzero_si128();
+    __m128i decay = _mm_set1_epi16((short)(s->decay << 8));
+    for (; i + 16 <= n; i += 16) {
+        __m128i lvl = _mm_loadu_si128((const __m128i*)&level[i]);
+        __m128i lit = _mm_loadu_si128((const __m128i*)&fresh[i]);
+        __m128i lo = _mm_mulhi_epu16(_mm_unpacklo_epi8(lvl, zero), decay);
+        __m128i hi = _mm_mulhi_epu16(_mm_unpackhi_epi8(lvl, zero), decay);
+        lvl = _mm_max_epu8(_mm_packus_epi16(lo, hi), lit);
+        _mm_storeu_si128((__m128i*)&level[i], lvl);
+    }
+#endif
+    for (; i < n; i++) {
+        uint8_t faded = (uint8_t)((level[i] * s->decay) >> 8);
+        level[i] = fresh[i] > faded ? fresh[i] : faded;
+    }
+}
+
+// The output size follows the emulated resolution; callers check
+// scaler_width()/scaler_height() after each frame.
+const uint32_t* scale_frame(scaler s, chip8 emu) {
+    packed_screen screen;
+    pack_screen(emu, &screen);
+
+    if ((screen.mode ^ s->mode) & SCREEN_HIRES) {
+        // a new layout: nothing on the old one should linger
+        s->width = PACKED_WIDTH(&screen) * s->factor;
+        s->height = PACKED_HEIGHT(&screen) * s->factor;
+        for (int p = 0; p < NUM_PLANES; p++) {
+            memset(s->level[p], 0, (size_t)s->width * s->height);
+        }
+        s->colour = false;
+    }
+    s->colour |= (screen.mode & SCREEN_PLANE2) != 0;
+    s->mode = screen.mode;
+
+    size_t n = (size_t)s->width * s->height;
+    filter_rows(s, screen.rows[0], s->fresh[0]);
+    persist(s, s->level[0], s->fresh[0]);
+    if (!s->colour) {
+        for (size_t i = 0; i < n; i++) {
+            s->pixels[i] = s->palette[s->level[0][i]];
+        }
+        return s->pixels;
+    }
+
+    filter_rows(s, screen.rows[1], s->fresh[1]);
+    persist(s, s->level[1], s->fresh[1]);
+    for (size_t i = 0; i < n; i++) {
+        s->pixels[i] = s->palette2[(s->level[0][i] & 0xF0) | s->level[1][i] >> 4];
+    }
+    return s->pixels;
+}
@@ -0,0 +1,110 @@
+#include "../include/screen.h"
+#include "../include/chip8_impl.h"
+#include <string.h>
+
+#define ROW_BYTES (ROW_WORDS * sizeof(uint64_t))
+
+// The 16 sprite bits with their MSB at pixel `x` of a 64-pixel word.
+static uint64_t span_word(uint16_t bits, int x) {
+    if (x <= -16 || x >= 64) {
+        return 0;
+    }
+    return x <= 48 ? (uint64_t)bits << (48 - x) : (uint64_t)bits >> (x - 48);
+}
+
+// The sprite row is MSB-aligned in `bits`; pixels past width `w` wrap to the
+// left edge or, with wrap false, are dropped. The row is ROW_WORDS words,
+// MSB = leftmost pixel.
+bool xor_row(uint64_t* row, uint16_t bits, int x, int w, bool wrap) {
+    bool hit = false;
+    for (int k = 0; k < ROW_WORDS; k++) {
+        int n = w - 64 * k;
+        if (n <= 0) {
+            break;
+        }
+        uint64_t mask = span_word(bits, x - 64 * k);
+        if (wrap && x) {
+            mask |= span_word(bits, x - w - 64 * k);
+        }
+        if (n < 64) {
+            mask &= ~(uint64_t)0 << (64 - n);
+        }
+        hit |= (row[k] & mask) != 0;
+        row[k] ^= mask;
+    }
+    return hit;
+}
+
+void clear_screen(chip8 emu) {
+    for (int p = 0; p < NUM_PLANES; p++) {
+        if (emu->planes & (1 << p)) {
+            memset(emu->screen[p], 0, sizeof(emu->screen[p]));
+        }
+    }
+}
+
+// 00FE/00FF. The two layouts differ, so switching starts from a blank screen.
+void set_resolution(chip8 emu, bool hires) {
+    emu->hires = hires;
+    memset(emu->screen, 0, sizeof(emu->screen));
+}
+
+void scroll_down(chip8 emu, int n) {
+    int h = emu->hires ? HIRES_HEIGHT : SCREEN_HEIGHT;
+    if (n > h) {
+        n = h;
+    }
+    for (int p = 0; p < NUM_PLANES; p++) {
+        if (emu->planes & (1 << p)) {
+            memmove(emu->screen[p][n], emu->screen[p][0], (size_t)(h - n) * ROW_BYTES);
+            memset(emu->screen[p][0], 0, (size_t)n * ROW_BYTES);
+        }
+    }
+}
+
+void scroll_up(chip8 emu, int n) {
+    int h = emu->hires ? HIRES_HEIGHT : SCREEN_HEIGHT;
+    if (n > h) {
+        n = h;
+    }
+    for (int p = 0; p < NUM_PLANES; p++) {
+        if (emu->planes & (1 << p)) {
+            memmove(emu->screen[p][0], emu->screen[p][n], (size_t)(h - n) * ROW_BYTES);
+            memset(emu->screen[p][h - n], 0, (size_t)n * ROW_BYTES);
+        }
+    }
+}
+
+// 00FB: four pixels right. In lo-res the row is word 0 alone.
+void scroll_right(chip8 emu) {
+    for (int p = 0; p < NUM_PLANES; p++) {
+        if (!(emu->planes & (1 << p))) {
+            continue;
+        }
+        for (int y = 0; y < HIRES_HEIGHT; y++) {
+            uint64_t* row = emu->screen[p][y];
+            if (emu->hires) {
+                row[1] = (row[1] >> 4) | (row[0] << 60);
+            }
+            row[0] >>= 4;
+        }
+    }
+}
+
+// 00FC: four pixels left.
+void scroll_left(chip8 emu) {
+    for (int p = 0; p < NUM_PLANES; p++) {
+        if (!(emu->planes & (1 << p))) {
+            continue;
+        }
+        for (int y = 0; y < HIRES_HEIGHT; y++) {
+            uint64_t* row = emu->screen[p][y];
+            if (emu->hires) {
+                row[0] = (row[0] << 4) | (row[1] >> 60);
+                row[1] <<= 4;
+            } else {
+                row[0] <<= 4;
+            }
+        }
+    }
+}
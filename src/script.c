@@ -0,0 +1,82 @@
+#include "../include/script.h"
+#include "../include/helpers.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Insertion sort: scripts are short, mostly sorted already, and a press and
+// release in the same frame must keep their order.
+static void sort_events(input_event* events, int count) {
+    for (int i = 1; i < count; i++) {
+        input_event e = events[i];
+        int j = i - 1;
+        while (j >= 0 && events[j].frame > e.frame) {
+            events[j + 1] = events[j];
+            j--;
+        }
+        events[j + 1] = e;
+    }
+}
+
+int load_script(const char* path, input_script* script) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    int cap = 64;
+    script->events = malloc(cap * sizeof(input_event));
+    script->count = 0;
+
+    unsigned frame, key, pressed;
+    while (fscanf(f, "%u %x %u", &frame, &key, &pressed) == 3) {
+        if (key >= NUM_KEYS) {
+            fprintf(stderr, "%s: bad key %X\n", path, key);
+            fclose(f);
+            free_script(script);
+            return -1;
+        }
+        if (script->count == cap) {
+            cap *= 2;
+            script->events = realloc(script->events, cap * sizeof(input_event));
+        }
+        input_event* e = &script->events[script->count++];
+        e->frame = frame;
+        e->key = (uint8_t)key;
+        e->pressed = pressed != 0;
+    }
+    fclose(f);
+
+    sort_events(script->events, script->count);
+    return 0;
+}
+
+int save_script(const char* path, const input_script* script) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    for (int i = 0; i < script->count; i++) {
+        const input_event* e = &script->events[i];
+        fprintf(f, "%u %X %d\n", e->frame, e->key, e->pressed);
+    }
+    fclose(f);
+    return 0;
+}
+
+void free_script(input_script* script) {
+    free(script->events);
+    script->events = NULL;
+    script->count = 0;
+}
+
+// Applies every event up to and including `frame`, starting at index `next`.
+// Returns the index of the first event still pending.
+int apply_script(chip8 emu, const input_script* script, int next, uint32_t frame) {
+    while (next < script->count && script->events[next].frame <= frame) {
+        keypress(emu, script->events[next].key, script->events[next].pressed);
+        next++;
+    }
+    return next;
+}
@@ -0,0 +1,127 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/shm.h"
+#include "../include/helpers.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+struct shm_publisher_state {
+    char name[256];
+    struct shared_frame* shared;
+};
+
+shm_publisher create_publisher(const char* name) {
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        perror("shm_open");
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(struct shared_frame)) != 0) {
+        perror("ftruncate");
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    void* mem = mmap(NULL, sizeof(struct shared_frame), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        perror("mmap");
+        shm_unlink(name);
+        return NULL;
+    }
+
+    shm_publisher pub = (shm_publisher)malloc(sizeof(struct shm_publisher_state));
+    if (!pub) {
+        fprintf(stderr, "Failed to allocate memory for publisher\n");
+        exit(EXIT_FAILURE);
+    }
+    snprintf(pub->name, sizeof(pub->name), "%s", name);
+    pub->shared = mem;
+
+    memset(pub->shared, 0, sizeof(struct shared_frame));
+    pub->shared->width = SCREEN_WIDTH;
+    pub->shared->height = SCREEN_HEIGHT;
+    pub->shared->version = SHARED_FRAME_VERSION;
+    __atomic_store_n(&pub->shared->magic, SHARED_FRAME_MAGIC, __ATOMIC_RELEASE);
+    return pub;
+}
+
+void destroy_publisher(shm_publisher pub) {
+    munmap(pub->shared, sizeof(struct shared_frame));
+    shm_unlink(pub->name);
+    free(pub);
+}
+
+void publish_frame(shm_publisher pub, chip8 emu, uint64_t frame) {
+    struct shared_frame* f = pub->shared;
+    uint16_t keys = 0;
+    for (int i = 0; i < NUM_KEYS; i++) {
+        keys |= (uint16_t)get_key(emu, i) << i;
+    }
+
+    // the mode bits of pack_screen(), without staging the planes
+    uint8_t mode = get_hires(emu) ? SCREEN_HIRES : 0;
+    const uint64_t* plane2 = get_plane(emu, 1);
+    for (int i = 0; i < HIRES_HEIGHT * ROW_WORDS; i++) {
+        if (plane2[i]) {
+            mode |= SCREEN_PLANE2;
+            break;
+        }
+    }
+
+    uint32_t seq = __atomic_load_n(&f->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&f->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    // straight from the emulator's planes into the segment
+    for (int p = 0; p < NUM_PLANES; p++) {
+        memcpy(f->rows[p], get_plane(emu, p), sizeof(f->rows[p]));
+    }
+    f->mode = mode;
+    f->width = mode & SCREEN_HIRES ? HIRES_WIDTH : SCREEN_WIDTH;
+    f->height = mode & SCREEN_HIRES ? HIRES_HEIGHT : SCREEN_HEIGHT;
+    f->keys = keys;
+    f->frame = frame;
+
+    __atomic_store_n(&f->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+struct shared_frame* map_shared_frame(const char* name) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        perror("shm_open");
+        return NULL;
+    }
+    void* mem = mmap(NULL, sizeof(struct shared_frame), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
+    }
+    struct shared_frame* f = mem;
+    if (__atomic_load_n(&f->magic, __ATOMIC_ACQUIRE) != SHARED_FRAME_MAGIC
+            || f->version != SHARED_FRAME_VERSION) {
+        fprintf(stderr, "%s: not a chip8 frame segment\n", name);
+        munmap(mem, sizeof(struct shared_frame));
+        return NULL;
+    }
+    return f;
+}
+
+void unmap_shared_frame(struct shared_frame* f) {
+    munmap(f, sizeof(struct shared_frame));
+}
+
+void read_shared_frame(const struct shared_frame* f, struct shared_frame* out) {
+    uint32_t before, after;
+    do {
+        before = __atomic_load_n(&f->seq, __ATOMIC_ACQUIRE);
+        memcpy(out, f, sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&f->seq, __ATOMIC_RELAXED);
+    } while ((before & 1) || before != after);
+    out->seq = before;
+}
@@ -0,0 +1,289 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/stream.h"
+#include "../include/helpers.h"
+#include "../include/net.h"
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define MAX_CLIENTS 16
+
+typedef struct {
+    int fd;
+    bool needs_keyframe;
+} stream_peer;
+
+struct stream_server_state {
+    int listen_fd;
+    char unix_path[108];
+    stream_peer peers[MAX_CLIENTS];
+    int npeers;
+    packed_screen last;
+    uint32_t since_keyframe;
+};
+
+struct stream_client_state {
+    int fd;
+};
+
+stream_server create_stream_server(const char* addr) {
+    stream_server server = (stream_server)malloc(sizeof(struct stream_server_state));
+    if (!server) {
+        fprintf(stderr, "Failed to allocate memory for stream server\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(server, 0, sizeof(*server));
+    server->listen_fd = open_socket(addr, true, server->unix_path);
+    if (server->listen_fd < 0 || set_nonblocking(server->listen_fd) != 0) {
+        if (server->listen_fd >= 0) {
+            close(server->listen_fd);
+        }
+        free(server);
+        return NULL;
+    }
+    return server;
+}
+
+void destroy_stream_server(stream_server server) {
+    for (int i = 0; i < server->npeers; i++) {
+        close(server->peers[i].fd);
+    }
+    close(server->listen_fd);
+    if (server->unix_path[0]) {
+        unlink(server->unix_path);
+    }
+    free(server);
+}
+
+static void drop_peer(stream_server server, int i) {
+    close(server->peers[i].fd);
+    server->peers[i] = server->peers[--server->npeers];
+}
+
+// Accepts new viewers and applies their key events. Returns the number of
+// connected viewers.
+int stream_poll(stream_server server, chip8 emu) {
+    int fd;
+    while ((fd = accept(server->listen_fd, NULL, NULL)) >= 0) {
+        if (server->npeers == MAX_CLIENTS || set_nonblocking(fd) != 0) {
+            close(fd);
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        server->peers[server->npeers].fd = fd;
+        server->peers[server->npeers].needs_keyframe = true;
+        server->npeers++;
+    }
+
+    for (int i = 0; i < server->npeers; i++) {
+        uint8_t events[64];
+        ssize_t n = recv(server->peers[i].fd, events, sizeof(events), 0);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            drop_peer(server, i--);
+            continue;
+        }
+        for (ssize_t e = 0; e < n; e++) {
+            keypress(emu, events[e] & 0x0F, (events[e] & 0x80) != 0);
+        }
+    }
+    return server->npeers;
+}
+
+static uint8_t row_byte(const uint64_t* row, int i) {
+    return (uint8_t)(row[i / 8] >> (56 - 8 * (i % 8)));
+}
+
+static size_t encode_row(const uint64_t* row, int bytes, uint8_t* out) {
+    size_t len = 0;
+    int i = 0;
+    while (i < bytes) {
+        uint8_t b = row_byte(row, i);
+        uint8_t run = 1;
+        while (i + run < bytes && row_byte(row, i + run) == b) {
+            run++;
+        }
+        out[len++] = run;
+        out[len++] = b;
+        i += run;
+    }
+    return len;
+}
+
+// Encodes the rows of `cur` that differ from `prev`, or a keyframe when
+// `prev` is NULL. `prev` must be in the same mode. Returns the message
+// length.
+size_t encode_frame(const packed_screen* prev, const packed_screen* cur, uint32_t frame, uint8_t* out) {
+    size_t len = 7;
+    uint8_t count = 0;
+    int bytes = PACKED_WIDTH(cur) / 8;
+    int planes = prev || (cur->mode & SCREEN_PLANE2) ? NUM_PLANES : 1;
+    out[0] = prev ? 'D' : 'K';
+    out[1] = (uint8_t)frame;
+    out[2] = (uint8_t)(frame >> 8);
+    out[3] = (uint8_t)(frame >> 16);
+    out[4] = (uint8_t)(frame >> 24);
+    out[5] = cur->mode;
+    for (int p = 0; p < planes; p++) {
+        for (int y = 0; y < PACKED_HEIGHT(cur); y++) {
+            const uint64_t* row = cur->rows[p][y];
+            if (prev && memcmp(prev->rows[p][y], row, sizeof(prev->rows[p][y])) == 0) {
+                continue;
+            }
+            out[len] = (uint8_t)(p << 7 | y);
+            size_t row_len = encode_row(row, bytes, &out[len + 2]);
+            out[len + 1] = (uint8_t)row_len;
+            len += 2 + row_len;
+            count++;
+        }
+    }
+    out[6] = count;
+    return len;
+}
+
+static bool send_all(int fd, const uint8_t* buf, size_t len) {
+    // messages are far below the socket buffer size; a viewer that cannot
+    // take a whole frame is too far behind and gets dropped
+    ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+    return n == (ssize_t)len;
+}
+
+void stream_frame(stream_server server, chip8 emu, uint32_t frame) {
+    packed_screen screen;
+    uint8_t delta[STREAM_MAX_MESSAGE];
+    uint8_t key[STREAM_MAX_MESSAGE];
+    size_t delta_len = 0;
+    size_t key_len = 0;
+
+    pack_screen(emu, &screen);
+    bool same_mode = ((screen.mode ^ server->last.mode) & SCREEN_HIRES) == 0;
+    if (++server->since_keyframe >= STREAM_KEYFRAME_INTERVAL || !same_mode) {
+        server->since_keyframe = 0;
+        for (int i = 0; i < server->npeers; i++) {
+            server->peers[i].needs_keyframe = true;
+        }
+    }
+
+    for (int i = 0; i < server->npeers; i++) {
+        stream_peer* peer = &server->peers[i];
+        const uint8_t* msg;
+        size_t len;
+        if (peer->needs_keyframe) {
+            if (!key_len) {
+                key_len = encode_frame(NULL, &screen, frame, key);
+            }
+            msg = key;
+            len = key_len;
+        } else {
+            if (!delta_len) {
+                delta_len = encode_frame(&server->last, &screen, frame, delta);
+            }
+            msg = delta;
+            len = delta_len;
+        }
+        if (!send_all(peer->fd, msg, len)) {
+            drop_peer(server, i--);
+            continue;
+        }
+        peer->needs_keyframe = false;
+    }
+
+    server->last = screen;
+}
+
+stream_client connect_stream(const char* addr) {
+    int fd = open_socket(addr, false, NULL);
+    if (fd < 0) {
+        return NULL;
+    }
+    stream_client client = (stream_client)malloc(sizeof(struct stream_client_state));
+    if (!client) {
+        fprintf(stderr, "Failed to allocate memory for stream client\n");
+        exit(EXIT_FAILURE);
+    }
+    client->fd = fd;
+    return client;
+}
+
+void destroy_stream_client(stream_client client) {
+    close(client->fd);
+    free(client);
+}
+
+int stream_client_fd(stream_client client) {
+    return client->fd;
+}
+
+static bool recv_all(int fd, uint8_t* buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = recv(fd, buf, len, 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+// Blocks for one frame message and applies it to `screen`. Returns the
+// number of bytes it took on the wire, or -1 when the stream ended.
+int stream_receive(stream_client client, packed_screen* screen, uint32_t* frame) {
+    uint8_t header[7];
+    if (!recv_all(client->fd, header, sizeof(header))) {
+        return -1;
+    }
+    if (header[0] != 'K' && header[0] != 'D') {
+        fprintf(stderr, "stream: bad message type %02X\n", header[0]);
+        return -1;
+    }
+    *frame = (uint32_t)header[1] | (uint32_t)header[2] << 8
+        | (uint32_t)header[3] << 16 | (uint32_t)header[4] << 24;
+    if (header[0] == 'K') {
+        memset(screen->rows, 0, sizeof(screen->rows));
+    }
+    screen->mode = header[5];
+    int bytes = PACKED_WIDTH(screen) / 8;
+
+    int total = sizeof(header);
+    for (int r = 0; r < header[6]; r++) {
+        uint8_t row_header[2];
+        uint8_t data[2 * STREAM_ROW_BYTES];
+        if (!recv_all(client->fd, row_header, 2)
+                || row_header[1] > sizeof(data) || (row_header[1] & 1)
+                || !recv_all(client->fd, data, row_header[1])) {
+            return -1;
+        }
+        int plane = row_header[0] >> 7;
+        int y = row_header[0] & 0x7F;
+        if (y >= PACKED_HEIGHT(screen)) {
+            return -1;
+        }
+        uint64_t row[ROW_WORDS] = { 0 };
+        int filled = 0;
+        for (int i = 0; i < row_header[1]; i += 2) {
+            for (int k = 0; k < data[i] && filled < bytes; k++, filled++) {
+                row[filled / 8] |= (uint64_t)data[i + 1] << (56 - 8 * (filled % 8));
+            }
+        }
+        if (filled != bytes) {
+            return -1;
+        }
+        memcpy(screen->rows[plane][y], row, sizeof(row));
+        total += 2 + row_header[1];
+    }
+    return total;
+}
+
+int stream_send_key(stream_client client, uint8_t key, bool pressed) {
+    uint8_t event = (uint8_t)((key & 0x0F) | (pressed ? 0x80 : 0));
+    return send(client->fd, &event, 1, MSG_NOSIGNAL) == 1 ? 0 : -1;
+}
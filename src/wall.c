@@ -0,0 +1,169 @@
+#include "../include/wall.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BACKGROUND 0xFF000000u
+
+// background, plane 1, plane 2, both; as the frontend draws them
+static const uint32_t PALETTE[4] = { BACKGROUND, 0xFFFFFFFFu, 0xFFFF6600u, 0xFF662200u };
+
+typedef struct {
+    chip8 emu;
+    bool hires;
+    bool stale; // repaint every row
+    uint64_t shown[NUM_PLANES][HIRES_HEIGHT][ROW_WORDS];
+} wall_tile;
+
+struct wall_state {
+    int count;
+    int cols;
+    int width;
+    int height;
+    wall_tile* tiles;
+    uint32_t* pixels;
+    uint8_t* dirty; // one flag per atlas row
+};
+
+// `cols` 0 picks the smallest square-ish grid that fits `count` tiles.
+wall create_wall(chip8* emus, int count, int cols) {
+    wall w = (wall)malloc(sizeof(struct wall_state));
+    if (!w) {
+        fprintf(stderr, "Failed to allocate memory for wall\n");
+        exit(EXIT_FAILURE);
+    }
+    if (cols <= 0) {
+        cols = 1;
+        while (cols * cols < count) {
+            cols++;
+        }
+    }
+    w->count = count;
+    w->cols = cols;
+    w->width = cols * WALL_TILE_WIDTH;
+    w->height = (count + cols - 1) / cols * WALL_TILE_HEIGHT;
+    w->tiles = calloc((size_t)count, sizeof(wall_tile));
+    w->pixels = malloc((size_t)w->width * w->height * sizeof(uint32_t));
+    w->dirty = malloc((size_t)w->height);
+    if (!w->tiles || !w->pixels || !w->dirty) {
+        fprintf(stderr, "Failed to allocate memory for wall\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < count; i++) {
+        w->tiles[i].emu = emus[i];
+        w->tiles[i].stale = true;
+    }
+    // empty grid cells stay background; the first upload covers everything
+    for (size_t i = 0; i < (size_t)w->width * w->height; i++) {
+        w->pixels[i] = BACKGROUND;
+    }
+    memset(w->dirty, 1, (size_t)w->height);
+    return w;
+}
+
+void destroy_wall(wall w) {
+    free(w->tiles);
+    free(w->pixels);
+    free(w->dirty);
+    free(w);
+}
+
+int wall_width(wall w) {
+    return w->width;
+}
+
+int wall_height(wall w) {
+    return w->height;
+}
+
+const uint32_t* wall_pixels(wall w) {
+    return w->pixels;
+}
+
+void wall_tile_origin(wall w, int tile, int* x, int* y) {
+    *x = tile % w->cols * WALL_TILE_WIDTH;
+    *y = tile / w->cols * WALL_TILE_HEIGHT;
+}
+
+// The tile under an atlas position, or -1.
+int wall_tile_at(wall w, int x, int y) {
+    if (x < 0 || y < 0 || x >= w->width || y >= w->height) {
+        return -1;
+    }
+    int tile = y / WALL_TILE_HEIGHT * w->cols + x / WALL_TILE_WIDTH;
+    return tile < w->count ? tile : -1;
+}
+
+// Paints one emulated row, `scale` atlas pixels per emulated pixel.
+static void paint_row(wall w, const uint64_t* p1, const uint64_t* p2, int width, int scale, uint32_t* out) {
+    for (int x = 0; x < width; x++) {
+        int bit = 63 - x % 64;
+        int lit = (int)((p1[x / 64] >> bit) & 1) | (int)((p2[x / 64] >> bit) & 1) << 1;
+        for (int s = 0; s < scale; s++) {
+            out[x * scale + s] = PALETTE[lit];
+        }
+    }
+    for (int s = 1; s < scale; s++) {
+        memcpy(out + (size_t)s * w->width, out, (size_t)width * scale * sizeof(uint32_t));
+    }
+}
+
+// Repaints the rows that changed since the last call. Returns the number of
+// dirty atlas rows.
+int wall_render(wall w) {
+    for (int i = 0; i < w->count; i++) {
+        wall_tile* t = &w->tiles[i];
+        bool hires = get_hires(t->emu);
+        int width = hires ? HIRES_WIDTH : SCREEN_WIDTH;
+        int height = hires ? HIRES_HEIGHT : SCREEN_HEIGHT;
+        int scale = WALL_TILE_WIDTH / width;
+        const uint64_t* p1 = get_plane(t->emu, 0);
+        const uint64_t* p2 = get_plane(t->emu, 1);
+        if (hires != t->hires) {
+            t->hires = hires;
+            t->stale = true;
+        }
+
+        int ox, oy;
+        wall_tile_origin(w, i, &ox, &oy);
+        for (int y = 0; y < height; y++) {
+            const uint64_t* r1 = &p1[y * ROW_WORDS];
+            const uint64_t* r2 = &p2[y * ROW_WORDS];
+            if (!t->stale && memcmp(t->shown[0][y], r1, sizeof(t->shown[0][y])) == 0
+                    && memcmp(t->shown[1][y], r2, sizeof(t->shown[1][y])) == 0) {
+                continue;
+            }
+            memcpy(t->shown[0][y], r1, sizeof(t->shown[0][y]));
+            memcpy(t->shown[1][y], r2, sizeof(t->shown[1][y]));
+            int row = oy + y * scale;
+            paint_row(w, r1, r2, width, scale, &w->pixels[(size_t)row * w->width + ox]);
+            memset(&w->dirty[row], 1, (size_t)scale);
+        }
+        t->stale = false;
+    }
+
+    int n = 0;
+    for (int y = 0; y < w->height; y++) {
+        n += w->dirty[y];
+    }
+    return n;
+}
+
+// Finds the next run of dirty rows at or after `from`, clears it and stores
+// its length. Returns the first row, or -1 when there are none left.
+int wall_dirty(wall w, int from, int* rows) {
+    int y = from;
+    while (y < w->height && !w->dirty[y]) {
+        y++;
+    }
+    if (y >= w->height) {
+        return -1;
+    }
+    int end = y;
+    while (end < w->height && w->dirty[end]) {
+        w->dirty[end++] = 0;
+    }
+    *rows = end - y;
+    return y;
+}
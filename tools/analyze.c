@@ -0,0 +1,145 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/analyze.h"
+#include "../include/chip8.h"
+
+// Static ROM analyzer: summary, disassembly listing (-d) or control-flow
+// graph in Graphviz format (-g). Results are cached per ROM hash in the
+// cache directory so repeated runs and engines at load time skip the work.
+
+static void usage(const char* prog) {
+    printf("Usage: %s [-d] [-g] [-c cache_dir] rom\n", prog);
+}
+
+static void listing(const rom_analysis* a, const uint8_t* rom) {
+    uint32_t end = START_ADDR + a->rom_size;
+    uint32_t addr = START_ADDR;
+    while (addr < end) {
+        uint8_t f = a->flags[addr];
+        if ((f & BYTE_CODE) && addr + 1 < end) {
+            char text[32];
+            uint16_t op = rom[addr - START_ADDR] << 8 | rom[addr + 1 - START_ADDR];
+            disassemble(op, text, sizeof(text));
+            if (f & BYTE_CALL) {
+                printf("\nsub_%03X:\n", addr);
+            } else if (f & BYTE_LEADER) {
+                printf("L%03X:\n", addr);
+            }
+            const char* note = (f | a->flags[addr + 1]) & BYTE_SMC ? "; self-modified"
+                : f & BYTE_INDIRECT ? "; indirect jump" : NULL;
+            if (op == 0xF000 && addr + 3 < end && (a->flags[addr + 2] & BYTE_OPERAND)) {
+                // F000 NNNN: one line for both words
+                uint16_t nnnn = rom[addr + 2 - START_ADDR] << 8 | rom[addr + 3 - START_ADDR];
+                snprintf(text, sizeof(text), "LD I, %04X", nnnn);
+                printf("  %03X  %04X  %s\n", addr, op, text);
+                addr += 4;
+                continue;
+            }
+            if (note) {
+                printf("  %03X  %04X  %-16s %s\n", addr, op, text, note);
+            } else {
+                printf("  %03X  %04X  %s\n", addr, op, text);
+            }
+            addr += 2;
+        } else {
+            printf("  %03X  %02X    DB %02X%s\n", addr, rom[addr - START_ADDR], rom[addr - START_ADDR],
+                   f & BYTE_SPRITE ? "  ; sprite" : f & BYTE_WRITTEN ? "  ; variable" : "");
+            addr++;
+        }
+    }
+}
+
+static void graph(const rom_analysis* a) {
+    printf("digraph rom {\n  node [shape=box fontname=monospace];\n");
+    for (int i = 0; i < a->nblocks; i++) {
+        const basic_block* b = &a->blocks[i];
+        printf("  b%03X [label=\"%03X-%03X\"%s];\n", b->start, b->start, b->last,
+               a->flags[b->start] & BYTE_CALL ? " style=bold" : "");
+        for (int s = 0; s < b->nsucc; s++) {
+            printf("  b%03X -> b%03X;\n", b->start, b->succ[s]);
+        }
+    }
+    for (int i = 0; i < a->ncalls; i++) {
+        const basic_block* b = find_block(a, a->calls[i].caller);
+        if (b) {
+            printf("  b%03X -> b%03X [style=dashed];\n", b->start, a->calls[i].callee);
+        }
+    }
+    printf("}\n");
+}
+
+static void summary(const rom_analysis* a) {
+    int code = 0, sprite = 0, smc = 0, data = 0;
+    for (int i = START_ADDR; i < START_ADDR + a->rom_size; i++) {
+        uint8_t f = a->flags[i];
+        code += (f & (BYTE_CODE | BYTE_OPERAND)) != 0;
+        data += (f & (BYTE_CODE | BYTE_OPERAND)) == 0;
+        sprite += (f & BYTE_SPRITE) != 0;
+        smc += (f & BYTE_SMC) != 0;
+    }
+    printf("rom %016llX, %u bytes\n", (unsigned long long)a->rom_hash, a->rom_size);
+    printf("code bytes:  %d\n", code);
+    printf("data bytes:  %d (%d sprite)\n", data, sprite);
+    printf("blocks:      %d\n", a->nblocks);
+    printf("calls:       %d\n", a->ncalls);
+    printf("self-modified code bytes: %d\n", smc);
+}
+
+int main(int argc, char* argv[]) {
+    bool dis = false;
+    bool dot = false;
+    char cache[4096];
+    const char* home = getenv("HOME");
+    snprintf(cache, sizeof(cache), "%s/.cache/chyip8", home ? home : ".");
+    int opt;
+
+    while ((opt = getopt(argc, argv, "dgc:")) != -1) {
+        switch (opt) {
+            case 'd': dis = true; break;
+            case 'g': dot = true; break;
+            case 'c': snprintf(cache, sizeof(cache), "%s", optarg); break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind != 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    FILE* f = fopen(argv[optind], "rb");
+    if (!f) {
+        perror(argv[optind]);
+        return EXIT_FAILURE;
+    }
+    uint8_t rom[RAM_SIZE - START_ADDR];
+    size_t size = fread(rom, 1, sizeof(rom), f);
+    fclose(f);
+
+    if (strchr(cache, '/')) {
+        // create the parent of the default cache directory
+        char parent[4096];
+        snprintf(parent, sizeof(parent), "%s", cache);
+        *strrchr(parent, '/') = '\0';
+        mkdir(parent, 0755);
+    }
+    rom_analysis* a = cached_analysis(rom, size, cache);
+
+    if (dis) {
+        listing(a, rom);
+    } else if (dot) {
+        graph(a);
+    } else {
+        summary(a);
+    }
+
+    free_analysis(a);
+    return EXIT_SUCCESS;
+}
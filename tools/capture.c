@@ -0,0 +1,110 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "../include/audio.h"
+#include "../include/chip8.h"
+#include "../include/helpers.h"
+#include "../include/scale.h"
+#include "../include/script.h"
+
+// Headless screenshot: runs a ROM for a number of frames and writes the
+// final screen through the same scaler the SDL frontend uses, as a PPM.
+// With -w the buzzer is rendered into a WAV file alongside.
+
+static void usage(const char* prog) {
+    printf("Usage: %s [-f frames] [-F none|scale2x|scale3x] [-p decay] [-s seed] [-i inputs] [-w out.wav] rom out.ppm\n", prog);
+}
+
+int main(int argc, char* argv[]) {
+    int frames = 60;
+    scale_filter filter = FILTER_NONE;
+    int decay = 0;
+    uint32_t seed = 0xC8C8C8C8;
+    input_script inputs = { NULL, 0 };
+    const char* wav = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:F:p:s:i:w:")) != -1) {
+        switch (opt) {
+            case 'f': frames = atoi(optarg); break;
+            case 'F':
+                if (parse_filter(optarg, &filter) != 0) {
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'p': decay = atoi(optarg); break;
+            case 's': seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'i':
+                if (load_script(optarg, &inputs) != 0) {
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'w': wav = optarg; break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind != 2 || decay < 0 || decay > 255) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    chip8 emu = init_emulator();
+    set_rng(emu, seed);
+    if (load_rom(emu, argv[optind]) != 0) {
+        destroy_emulator(emu);
+        return EXIT_FAILURE;
+    }
+
+    audio sound = NULL;
+    if (wav) {
+        sound = create_audio(AUDIO_RATE, 0);
+        if (open_wav(sound, wav) != 0) {
+            destroy_audio(sound);
+            destroy_emulator(emu);
+            return EXIT_FAILURE;
+        }
+        attach_audio(sound, emu);
+    }
+
+    scaler s = create_scaler(filter, (uint8_t)decay, 0xFFFFFF, 0x000000);
+    const uint32_t* pixels = NULL;
+    int next = 0;
+    for (int frame = 0; frame < frames; frame++) {
+        next = apply_script(emu, &inputs, next, frame);
+        run_frame(emu);
+        if (sound) {
+            audio_pump(sound, emu);
+        }
+        // persistence depends on every frame, not just the last one
+        if (decay > 0 || frame == frames - 1) {
+            pixels = scale_frame(s, emu);
+        }
+    }
+
+    FILE* out = fopen(argv[optind + 1], "wb");
+    if (!out) {
+        perror(argv[optind + 1]);
+        return EXIT_FAILURE;
+    }
+    int w = scaler_width(s);
+    int h = scaler_height(s);
+    fprintf(out, "P6\n%d %d\n255\n", w, h);
+    for (int i = 0; pixels && i < w * h; i++) {
+        uint8_t rgb[3] = { (uint8_t)(pixels[i] >> 16), (uint8_t)(pixels[i] >> 8), (uint8_t)pixels[i] };
+        fwrite(rgb, 1, 3, out);
+    }
+    fclose(out);
+
+    if (sound) {
+        destroy_audio(sound);
+    }
+    destroy_scaler(s);
+    destroy_emulator(emu);
+    free_script(&inputs);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/catalog.h"
+
+// ROM library index: -u scans a directory into the index, otherwise lists
+// the index or, with -f, the entries matching a hash prefix or title.
+
+static void usage(const char* prog) {
+    printf("Usage: %s [-i index] [-u roms/ [-m meta.txt]] [-f query]\n", prog);
+}
+
+static void print_entry(catalog c, const catalog_entry* e) {
+    const char* quirks = catalog_string(c, e->quirks);
+    printf("%016llX  %-6s %3u  %-8s %-32s %s\n", (unsigned long long)e->hash,
+           platform_name(e->platform), e->speed, quirks[0] ? quirks : "-",
+           catalog_string(c, e->title), catalog_string(c, e->path));
+}
+
+int main(int argc, char* argv[]) {
+    char index[4096];
+    const char* home = getenv("HOME");
+    snprintf(index, sizeof(index), "%s/.cache/chyip8/catalog.idx", home ? home : ".");
+    const char* scan_dir = NULL;
+    const char* meta = NULL;
+    const char* query = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:u:m:f:")) != -1) {
+        switch (opt) {
+            case 'i': snprintf(index, sizeof(index), "%s", optarg); break;
+            case 'u': scan_dir = optarg; break;
+            case 'm': meta = optarg; break;
+            case 'f': query = optarg; break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (argc != optind || (meta && !scan_dir)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (scan_dir) {
+        // create the default index directory if needed
+        char parent[4096];
+        snprintf(parent, sizeof(parent), "%s", index);
+        char* slash = strrchr(parent, '/');
+        if (slash) {
+            *slash = '\0';
+            char* up = strrchr(parent, '/');
+            if (up) {
+                *up = '\0';
+                mkdir(parent, 0755);
+                *up = '/';
+            }
+            mkdir(parent, 0755);
+        }
+        int count = build_catalog(index, scan_dir, meta);
+        if (count < 0) {
+            return EXIT_FAILURE;
+        }
+        printf("indexed %d ROMs into %s\n", count, index);
+        return EXIT_SUCCESS;
+    }
+
+    catalog c = open_catalog(index);
+    if (!c) {
+        fprintf(stderr, "%s: no catalog, build one with -u\n", index);
+        return EXIT_FAILURE;
+    }
+    int found = 0;
+    if (query) {
+        for (int i = catalog_find(c, query, 0); i >= 0; i = catalog_find(c, query, i + 1)) {
+            print_entry(c, catalog_at(c, i));
+            found++;
+        }
+    } else {
+        for (int i = 0; i < catalog_count(c); i++) {
+            print_entry(c, catalog_at(c, i));
+        }
+        found = 1;
+    }
+    close_catalog(c);
+    return found ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,427 @@
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/chip8.h"
+#include "../include/helpers.h"
+#include "../include/script.h"
+
+// Coverage-guided input fuzzer.
+//
+// The corpus holds key input sequences together with the emulator state at
+// their end. A worker picks an entry, copies its state and runs a few more
+// frames of random key changes on the reference engine, which records every
+// PC it runs into a coverage bitmap. If the bitmap has addresses nobody has
+// reached before, the extended sequence and its end state become a new
+// entry, so no run ever replays a prefix from reset.
+//
+// A crash is a fault the core raised (see FAULT_* in chip8.h) or a PC below
+// START_ADDR. The first input that causes each kind is minimized by replaying
+// it from reset: cut after the frame the crash shows up in, then release as
+// many key presses as possible. It is saved as an input script that
+// `fuzz -r`, `golden -i` and `lockstep -i` replay.
+
+// not a core fault: the program ran into the interpreter area
+#define CRASH_PC 0x20
+#define CRASH_KINDS 6
+
+#define MAX_CORPUS 512
+#define MAX_FRAMES 65536
+#define MAX_REPLAYS 4000
+
+typedef struct {
+    uint16_t* keys; // keys held during each frame since reset
+    int frames;
+    chip8 state;    // after the last frame
+} corpus_entry;
+
+static const char* rom_path;
+static const char* out_dir = ".";
+static uint32_t seed = 0xC8C8C8C8;
+static int segment = 600;
+static double duration = 10.0;
+
+// the ROM just loaded; every run starts from a copy of it
+static chip8 pristine;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static corpus_entry corpus[MAX_CORPUS];
+static int corpus_size = 0;
+static uint8_t covered[COVERAGE_BYTES];
+static int covered_count = 0;
+static uint8_t crashes_found = 0;
+static uint64_t total_runs = 0;
+static uint64_t total_frames = 0;
+static bool stop = false;
+
+static void usage(const char* prog) {
+    printf("Usage: %s [-t seconds] [-l frames] [-j jobs] [-s seed] [-o dir] rom\n", prog);
+    printf("       %s -r script [-s seed] rom\n", prog);
+}
+
+static const char* crash_name(uint8_t kind) {
+    return kind == CRASH_PC ? "PC below 0x200" : fault_name(kind);
+}
+
+static uint32_t next_random(uint32_t* state) {
+    uint32_t r = *state;
+    r ^= r << 13;
+    r ^= r >> 17;
+    r ^= r << 5;
+    return *state = r;
+}
+
+static void hold_keys(chip8 emu, uint16_t mask) {
+    for (int k = 0; k < NUM_KEYS; k++) {
+        keypress(emu, k, (mask >> k) & 1);
+    }
+}
+
+static uint8_t crashes(chip8 emu, const uint8_t* map) {
+    uint8_t kinds = get_faults(emu);
+    for (int i = 0; i < START_ADDR / 8; i++) {
+        if (map[i]) {
+            kinds |= CRASH_PC;
+            break;
+        }
+    }
+    return kinds;
+}
+
+// Replays `keys` from the loaded ROM and returns the number of frames run
+// when one of the `want` crashes first showed up, or 0 if none did.
+static int replay(chip8 emu, uint8_t* map, const uint16_t* keys, int frames, uint8_t want) {
+    copy_emulator(emu, pristine);
+    memset(map, 0, COVERAGE_BYTES);
+    set_coverage(emu, map);
+    for (int f = 0; f < frames; f++) {
+        hold_keys(emu, keys[f]);
+        run_frame(emu);
+        if (crashes(emu, map) & want) {
+            return f + 1;
+        }
+    }
+    return 0;
+}
+
+// Shortens `keys` to where `kind` first happens, then releases runs of
+// frames' keys, halving the run length, while the crash still reproduces.
+// Returns the new length.
+static int minimize(chip8 emu, uint8_t* map, uint16_t* keys, int frames, uint8_t kind) {
+    int replays = 1;
+    int at = replay(emu, map, keys, frames, kind);
+    if (!at) {
+        return frames;
+    }
+    frames = at;
+    uint16_t* saved = malloc((size_t)frames * sizeof(uint16_t));
+    if (!saved) {
+        fprintf(stderr, "Failed to allocate memory for minimizing\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int run = frames; run > 0 && replays < MAX_REPLAYS; run /= 2) {
+        for (int start = 0; start < frames && replays < MAX_REPLAYS; start += run) {
+            int len = start + run > frames ? frames - start : run;
+            bool held = false;
+            for (int f = start; f < start + len; f++) {
+                held |= keys[f] != 0;
+            }
+            if (!held) {
+                continue;
+            }
+            memcpy(saved, &keys[start], (size_t)len * sizeof(uint16_t));
+            memset(&keys[start], 0, (size_t)len * sizeof(uint16_t));
+            at = replay(emu, map, keys, frames, kind);
+            replays++;
+            if (at) {
+                frames = at;
+            } else {
+                memcpy(&keys[start], saved, (size_t)len * sizeof(uint16_t));
+            }
+        }
+    }
+    free(saved);
+    return frames;
+}
+
+// Turns per-frame key masks into press and release events.
+static void to_script(const uint16_t* keys, int frames, input_script* script) {
+    int count = 0;
+    uint16_t held = 0;
+    for (int f = 0; f < frames; f++) {
+        count += __builtin_popcount(keys[f] ^ held);
+        held = keys[f];
+    }
+    script->events = malloc((size_t)(count ? count : 1) * sizeof(input_event));
+    script->count = 0;
+    if (!script->events) {
+        fprintf(stderr, "Failed to allocate memory for script\n");
+        exit(EXIT_FAILURE);
+    }
+    held = 0;
+    for (int f = 0; f < frames; f++) {
+        uint16_t changed = keys[f] ^ held;
+        for (int k = 0; k < NUM_KEYS; k++) {
+            if ((changed >> k) & 1) {
+                input_event* e = &script->events[script->count++];
+                e->frame = (uint32_t)f;
+                e->key = (uint8_t)k;
+                e->pressed = (keys[f] >> k) & 1;
+            }
+        }
+        held = keys[f];
+    }
+}
+
+static void report_crash(chip8 emu, uint8_t* map, const uint16_t* keys, int frames, uint8_t kind) {
+    uint16_t* copy = malloc((size_t)frames * sizeof(uint16_t));
+    if (!copy) {
+        fprintf(stderr, "Failed to allocate memory for crash\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(copy, keys, (size_t)frames * sizeof(uint16_t));
+    int len = minimize(emu, map, copy, frames, kind);
+
+    input_script script;
+    to_script(copy, len, &script);
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/crash-%02X.txt", out_dir, kind);
+    if (save_script(path, &script) == 0) {
+        pthread_mutex_lock(&lock);
+        printf("crash: %s after %d frames, %d key events -> %s\n", crash_name(kind), len,
+               script.count, path);
+        pthread_mutex_unlock(&lock);
+    }
+    free_script(&script);
+    free(copy);
+}
+
+// Adds the bits of `map` to the global coverage. Returns how many were new.
+static int merge_coverage(const uint8_t* map) {
+    int fresh = 0;
+    for (int i = 0; i < COVERAGE_BYTES; i++) {
+        uint8_t bits = map[i] & ~covered[i];
+        if (bits) {
+            fresh += __builtin_popcount(bits);
+            covered[i] |= bits;
+        }
+    }
+    covered_count += fresh;
+    return fresh;
+}
+
+static void* worker(void* arg) {
+    uint32_t rng = (uint32_t)(uintptr_t)arg * 0x9E3779B9u ^ (uint32_t)time(NULL);
+    rng |= 1;
+    chip8 emu = clone_emulator(pristine);
+    uint8_t* map = malloc(COVERAGE_BYTES);
+    uint16_t* keys = malloc(MAX_FRAMES * sizeof(uint16_t));
+    if (!map || !keys) {
+        fprintf(stderr, "Failed to allocate memory for worker\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&lock);
+        if (stop) {
+            pthread_mutex_unlock(&lock);
+            break;
+        }
+        corpus_entry* from = &corpus[next_random(&rng) % corpus_size];
+        pthread_mutex_unlock(&lock);
+        // entries never change once added
+        int len = 1 + (int)(next_random(&rng) % segment);
+        if (from->frames + len > MAX_FRAMES) {
+            continue;
+        }
+        copy_emulator(emu, from->state);
+        if (from->frames) {
+            memcpy(keys, from->keys, (size_t)from->frames * sizeof(uint16_t));
+        }
+        memset(map, 0, COVERAGE_BYTES);
+        set_coverage(emu, map);
+
+        uint16_t held = from->frames ? keys[from->frames - 1] : 0;
+        int frames = from->frames;
+        for (int f = 0; f < len; f++) {
+            uint32_t r = next_random(&rng);
+            if (r % 8 == 0) {
+                held = (r >> 3) % 4 == 0 ? 0 : held ^ (uint16_t)(1 << ((r >> 5) % NUM_KEYS));
+            }
+            keys[frames++] = held;
+            hold_keys(emu, held);
+            run_frame(emu);
+        }
+
+        uint8_t kinds = crashes(emu, map);
+        pthread_mutex_lock(&lock);
+        total_runs++;
+        total_frames += (uint64_t)len;
+        uint8_t fresh = kinds & ~crashes_found;
+        crashes_found |= kinds;
+        if (merge_coverage(map) && corpus_size < MAX_CORPUS) {
+            corpus_entry* e = &corpus[corpus_size];
+            e->keys = malloc((size_t)frames * sizeof(uint16_t));
+            if (!e->keys) {
+                fprintf(stderr, "Failed to allocate memory for corpus\n");
+                exit(EXIT_FAILURE);
+            }
+            memcpy(e->keys, keys, (size_t)frames * sizeof(uint16_t));
+            e->frames = frames;
+            e->state = clone_emulator(emu);
+            set_coverage(e->state, NULL);
+            corpus_size++;
+        }
+        pthread_mutex_unlock(&lock);
+
+        for (int k = 0; k < CRASH_KINDS; k++) {
+            if ((fresh >> k) & 1) {
+                report_crash(emu, map, keys, frames, (uint8_t)(1 << k));
+            }
+        }
+    }
+
+    free(keys);
+    free(map);
+    destroy_emulator(emu);
+    return NULL;
+}
+
+// -r: replays a script, such as a saved crash, and reports what it causes.
+static int replay_script(const char* path) {
+    input_script script;
+    if (load_script(path, &script) != 0) {
+        return EXIT_FAILURE;
+    }
+    int frames = (script.count ? (int)script.events[script.count - 1].frame : 0) + segment;
+    uint16_t* keys = calloc((size_t)frames, sizeof(uint16_t));
+    uint8_t* map = malloc(COVERAGE_BYTES);
+    if (!keys || !map) {
+        fprintf(stderr, "Failed to allocate memory for replay\n");
+        exit(EXIT_FAILURE);
+    }
+    uint16_t held = 0;
+    for (int f = 0, next = 0; f < frames; f++) {
+        for (; next < script.count && script.events[next].frame <= (uint32_t)f; next++) {
+            uint16_t bit = (uint16_t)(1 << script.events[next].key);
+            held = script.events[next].pressed ? held | bit : held & ~bit;
+        }
+        keys[f] = held;
+    }
+
+    chip8 emu = clone_emulator(pristine);
+    memset(map, 0, COVERAGE_BYTES);
+    set_coverage(emu, map);
+    uint8_t seen = 0;
+    for (int f = 0; f < frames; f++) {
+        hold_keys(emu, keys[f]);
+        run_frame(emu);
+        uint8_t fresh = crashes(emu, map) & ~seen;
+        for (int k = 0; k < CRASH_KINDS; k++) {
+            if ((fresh >> k) & 1) {
+                printf("crash: %s after %d frames\n", crash_name((uint8_t)(1 << k)), f + 1);
+            }
+        }
+        seen |= fresh;
+    }
+    if (seen) {
+        dump_state(emu, stdout);
+    } else {
+        printf("no crash in %d frames\n", frames);
+    }
+    destroy_emulator(emu);
+    free(map);
+    free(keys);
+    free_script(&script);
+    return seen ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[]) {
+    int nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char* script_path = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:l:j:s:o:r:")) != -1) {
+        switch (opt) {
+            case 't': duration = atof(optarg); break;
+            case 'l': segment = atoi(optarg); break;
+            case 'j': nthreads = atoi(optarg); break;
+            case 's': seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'o': out_dir = optarg; break;
+            case 'r': script_path = optarg; break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind != 1 || segment <= 0 || segment > MAX_FRAMES) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+    rom_path = argv[optind];
+
+    pristine = init_emulator();
+    set_rng(pristine, seed);
+    if (load_rom(pristine, rom_path) != 0) {
+        destroy_emulator(pristine);
+        return EXIT_FAILURE;
+    }
+    if (script_path) {
+        int status = replay_script(script_path);
+        destroy_emulator(pristine);
+        return status;
+    }
+
+    corpus[0].keys = NULL;
+    corpus[0].frames = 0;
+    corpus[0].state = clone_emulator(pristine);
+    corpus_size = 1;
+
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_t* threads = malloc(nthreads * sizeof(pthread_t));
+    for (int i = 0; i < nthreads; i++) {
+        pthread_create(&threads[i], NULL, worker, (void*)(uintptr_t)(i + 1));
+    }
+
+    double elapsed = 0;
+    while (elapsed < duration) {
+        struct timespec second = { 1, 0 };
+        if (duration - elapsed < 1) {
+            second.tv_sec = 0;
+            second.tv_nsec = (long)((duration - elapsed) * 1e9);
+        }
+        nanosleep(&second, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        elapsed = (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+        pthread_mutex_lock(&lock);
+        printf("%.0fs: %llu runs, %.2fM frames/s, corpus %d, %d addresses covered\n", elapsed,
+               (unsigned long long)total_runs, total_frames / elapsed / 1e6, corpus_size,
+               covered_count);
+        pthread_mutex_unlock(&lock);
+    }
+    pthread_mutex_lock(&lock);
+    stop = true;
+    pthread_mutex_unlock(&lock);
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    printf("%llu frames in %.1fs on %d threads, %d crash kinds\n", (unsigned long long)total_frames,
+           elapsed, nthreads, __builtin_popcount(crashes_found));
+    for (int i = 0; i < corpus_size; i++) {
+        free(corpus[i].keys);
+        destroy_emulator(corpus[i].state);
+    }
+    destroy_emulator(pristine);
+    return crashes_found ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,291 @@
+#define _POSIX_C_SOURCE 200809L
+#include <dirent.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/chip8.h"
+#include "../include/helpers.h"
+#include "../include/script.h"
+
+// Headless golden-frame regression runner.
+//
+// Every file in ROM_DIR is run for a fixed number of frames with a fixed
+// seed and an optional scripted input file. The screen is hashed every
+// CHECKPOINT frames and compared against MANIFEST, one line per checkpoint:
+//
+//     <rom name> <frame> <hash>
+
+#define MAX_CHECKPOINTS 1024
+
+typedef struct {
+    char name[256];
+    uint32_t frame;
+    uint64_t hash;
+} golden_entry;
+
+typedef struct {
+    char* path;
+    char* name;
+    int ncheckpoints;
+    uint64_t hashes[MAX_CHECKPOINTS];
+    bool failed_load;
+} rom_job;
+
+static int frames = 600;
+static int checkpoint = 60;
+static uint32_t seed = 0xC8C8C8C8;
+static input_script inputs;
+
+static rom_job* jobs;
+static int njobs = 0;
+static int next_job = 0;
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void usage(const char* prog) {
+    printf("Usage: %s [-u] [-f frames] [-c checkpoint] [-s seed] [-i inputs] [-j jobs] rom_dir manifest\n", prog);
+    printf("  -u  record a new manifest instead of comparing\n");
+}
+
+static int compare_names(const void* a, const void* b) {
+    return strcmp(((const rom_job*)a)->name, ((const rom_job*)b)->name);
+}
+
+static int compare_golden(const void* a, const void* b) {
+    const golden_entry* x = a;
+    const golden_entry* y = b;
+    int c = strcmp(x->name, y->name);
+    return c ? c : (x->frame > y->frame) - (x->frame < y->frame);
+}
+
+static int scan_roms(const char* dir) {
+    DIR* d = opendir(dir);
+    if (!d) {
+        perror(dir);
+        return -1;
+    }
+    int cap = 64;
+    jobs = malloc(cap * sizeof(rom_job));
+    struct dirent* ent;
+    while ((ent = readdir(d))) {
+        if (ent->d_name[0] == '.') {
+            continue;
+        }
+        size_t len = strlen(dir) + strlen(ent->d_name) + 2;
+        char* path = malloc(len);
+        snprintf(path, len, "%s/%s", dir, ent->d_name);
+        struct stat st;
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+            free(path);
+            continue;
+        }
+        if (njobs == cap) {
+            cap *= 2;
+            jobs = realloc(jobs, cap * sizeof(rom_job));
+        }
+        rom_job* job = &jobs[njobs++];
+        memset(job, 0, sizeof(*job));
+        job->path = path;
+        job->name = path + strlen(dir) + 1;
+    }
+    closedir(d);
+    qsort(jobs, njobs, sizeof(rom_job), compare_names);
+    return 0;
+}
+
+static void run_job(chip8 emu, rom_job* job) {
+    reset(emu);
+    set_rng(emu, seed);
+    if (load_rom(emu, job->path) != 0) {
+        job->failed_load = true;
+        return;
+    }
+
+    int next = 0;
+    for (int frame = 0; frame < frames; frame++) {
+        next = apply_script(emu, &inputs, next, frame);
+        run_frame(emu);
+        if ((frame + 1) % checkpoint == 0) {
+            job->hashes[job->ncheckpoints++] = hash_screen(emu);
+        }
+    }
+}
+
+static void* worker(void* arg) {
+    (void)arg;
+    chip8 emu = init_emulator();
+    for (;;) {
+        pthread_mutex_lock(&job_lock);
+        int idx = next_job++;
+        pthread_mutex_unlock(&job_lock);
+        if (idx >= njobs) {
+            break;
+        }
+        run_job(emu, &jobs[idx]);
+    }
+    destroy_emulator(emu);
+    return NULL;
+}
+
+static int write_manifest(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    fprintf(f, "# frames=%d checkpoint=%d seed=%08X\n", frames, checkpoint, seed);
+    for (int i = 0; i < njobs; i++) {
+        for (int c = 0; c < jobs[i].ncheckpoints; c++) {
+            fprintf(f, "%s %d %016llX\n", jobs[i].name, (c + 1) * checkpoint,
+                    (unsigned long long)jobs[i].hashes[c]);
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+static int compare_manifest(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    int cap = 256;
+    int count = 0;
+    golden_entry* golden = malloc(cap * sizeof(golden_entry));
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#') {
+            continue;
+        }
+        golden_entry e;
+        unsigned long long h;
+        if (sscanf(line, "%255s %u %llx", e.name, &e.frame, &h) != 3) {
+            continue;
+        }
+        e.hash = h;
+        if (count == cap) {
+            cap *= 2;
+            golden = realloc(golden, cap * sizeof(golden_entry));
+        }
+        golden[count++] = e;
+    }
+    fclose(f);
+    qsort(golden, count, sizeof(golden_entry), compare_golden);
+
+    // both lists are sorted by name, so walk them together
+    int failures = 0;
+    int missing = 0;
+    int absent = 0;
+    int g = 0;
+    for (int i = 0; i <= njobs; i++) {
+        rom_job* job = i < njobs ? &jobs[i] : NULL;
+        for (; g < count && (!job || strcmp(golden[g].name, job->name) < 0); g++) {
+            if (g == 0 || strcmp(golden[g].name, golden[g - 1].name) != 0) {
+                printf("FAIL %s: in manifest but not in the rom directory\n", golden[g].name);
+                absent++;
+            }
+        }
+        if (!job) {
+            break;
+        }
+        if (job->failed_load) {
+            printf("FAIL %s: could not load\n", job->name);
+            failures++;
+        }
+        bool seen = false;
+        bool failed = job->failed_load;
+        for (; g < count && strcmp(golden[g].name, job->name) == 0; g++) {
+            seen = true;
+            if (failed) {
+                continue;
+            }
+            int c = (int)golden[g].frame / checkpoint - 1;
+            if (golden[g].frame % checkpoint != 0 || c < 0 || c >= job->ncheckpoints) {
+                printf("FAIL %s: frame %u is not a checkpoint of this run\n", job->name, golden[g].frame);
+                failed = true;
+            } else if (job->hashes[c] != golden[g].hash) {
+                printf("FAIL %s: frame %u expected %016llX got %016llX\n", job->name,
+                       golden[g].frame, (unsigned long long)golden[g].hash,
+                       (unsigned long long)job->hashes[c]);
+                failed = true;
+            }
+        }
+        if (!seen && !job->failed_load) {
+            printf("NEW  %s: not in manifest\n", job->name);
+            missing++;
+        }
+        failures += failed && !job->failed_load;
+    }
+    free(golden);
+
+    printf("%d roms, %d failed, %d not in manifest, %d missing\n", njobs, failures + absent, missing, absent);
+    return failures + absent ? 1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+    bool update = false;
+    int nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+
+    while ((opt = getopt(argc, argv, "uf:c:s:i:j:")) != -1) {
+        switch (opt) {
+            case 'u': update = true; break;
+            case 'f': frames = atoi(optarg); break;
+            case 'c': checkpoint = atoi(optarg); break;
+            case 's': seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'i':
+                if (load_script(optarg, &inputs) != 0) {
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'j': nthreads = atoi(optarg); break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind != 2 || checkpoint <= 0 || frames / checkpoint > MAX_CHECKPOINTS) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+
+    if (scan_roms(argv[optind]) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    pthread_t* threads = malloc(nthreads * sizeof(pthread_t));
+    for (int i = 0; i < nthreads; i++) {
+        pthread_create(&threads[i], NULL, worker, NULL);
+    }
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("ran %d roms x %d frames on %d threads in %.3fs\n", njobs, frames, nthreads, elapsed);
+
+    int status = update ? write_manifest(argv[optind + 1]) : compare_manifest(argv[optind + 1]);
+
+    for (int i = 0; i < njobs; i++) {
+        free(jobs[i].path);
+    }
+    free(jobs);
+    free_script(&inputs);
+    return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,215 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../include/chip8.h"
+#include "../include/engine.h"
+#include "../include/helpers.h"
+#include "../include/script.h"
+
+// Differential lockstep checker.
+//
+// Runs the reference engine and a candidate engine on the same ROM, seed and
+// input script. Every INTERVAL instructions the two states are hashed and
+// compared; on a mismatch both instances are rewound to the last matching
+// checkpoint and bisected with budgets that halve each round, so engines
+// that fuse several instructions still run them as they did, down to the
+// first instruction (or fused run) whose result differs.
+
+typedef struct {
+    uint32_t frame;
+    int tick;
+    int next_input;
+} cursor;
+
+static input_script inputs;
+
+static void usage(const char* prog) {
+    printf("Usage: %s [-e engine] [-f frames] [-n interval] [-s seed] [-i inputs] rom\n", prog);
+    printf("engines:\n");
+    list_engines(stdout);
+}
+
+// Same frame structure as run_frame(): inputs at the start of a frame,
+// TICKS_PER_FRAME instructions, then the timers.
+static void advance(chip8 emu, const struct engine* eng, cursor* c, int count) {
+    while (count > 0) {
+        if (c->tick == 0) {
+            c->next_input = apply_script(emu, &inputs, c->next_input, c->frame);
+        }
+        int chunk = TICKS_PER_FRAME - c->tick;
+        if (chunk > count) {
+            chunk = count;
+        }
+        int done = eng->run(emu, chunk);
+        c->tick += done;
+        count -= done;
+        if (c->tick == TICKS_PER_FRAME) {
+            tick_timer(emu);
+            c->tick = 0;
+            c->frame++;
+        }
+    }
+}
+
+// Faults are not part of hash_state(), but every engine has to raise the
+// same ones.
+static bool same_state(chip8 ref, chip8 test) {
+    return hash_state(ref) == hash_state(test) && get_faults(ref) == get_faults(test);
+}
+
+// Restores both instances from the snapshots and runs `count` instructions
+// as one budget. Returns true when they still agree.
+static bool replay(chip8 ref, chip8 test, chip8 ref_snap, chip8 test_snap,
+                   const struct engine* eng, cursor* c, int count) {
+    copy_emulator(ref, ref_snap);
+    copy_emulator(test, test_snap);
+    cursor tc = *c;
+    advance(ref, default_engine(), c, count);
+    advance(test, eng, &tc, count);
+    return same_state(ref, test);
+}
+
+static void report(chip8 ref, chip8 test, const char* name, uint64_t instr, cursor* c) {
+    printf("MISMATCH after instruction %llu (frame %u, tick %d)\n",
+           (unsigned long long)instr, c->frame, c->tick);
+    printf("--- reference\n");
+    dump_state(ref, stdout);
+    printf("--- %s\n", name);
+    dump_state(test, stdout);
+    for (int i = 0; i < RAM_SIZE; i++) {
+        if (get_ram(ref, i) != get_ram(test, i)) {
+            printf("ram[%03X]: %02X vs %02X\n", i, get_ram(ref, i), get_ram(test, i));
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const struct engine* candidate = default_engine();
+    int frames = 3600;
+    int interval = 64;
+    uint32_t seed = 0xC8C8C8C8;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "e:f:n:s:i:")) != -1) {
+        switch (opt) {
+            case 'e':
+                candidate = find_engine(optarg);
+                if (!candidate) {
+                    fprintf(stderr, "Unknown engine: %s\n", optarg);
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'f': frames = atoi(optarg); break;
+            case 'n': interval = atoi(optarg); break;
+            case 's': seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'i':
+                if (load_script(optarg, &inputs) != 0) {
+                    return EXIT_FAILURE;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind != 1 || interval <= 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    chip8 ref = init_emulator();
+    set_rng(ref, seed);
+    if (load_rom(ref, argv[optind]) != 0) {
+        destroy_emulator(ref);
+        return EXIT_FAILURE;
+    }
+    chip8 test = clone_emulator(ref);
+    set_engine(test, candidate);
+
+    // last matching state, to bisect from
+    chip8 ref_snap = clone_emulator(ref);
+    chip8 test_snap = clone_emulator(test);
+    cursor c = { 0, 0, 0 };
+    cursor snap_c = c;
+    uint64_t instr = 0;
+    uint64_t total = (uint64_t)frames * TICKS_PER_FRAME;
+    int status = EXIT_SUCCESS;
+
+    while (instr < total) {
+        int count = interval;
+        if ((uint64_t)count > total - instr) {
+            count = (int)(total - instr);
+        }
+        cursor tc = c;
+        advance(ref, default_engine(), &c, count);
+        advance(test, candidate, &tc, count);
+        instr += count;
+
+        if (same_state(ref, test)) {
+            copy_emulator(ref_snap, ref);
+            copy_emulator(test_snap, test);
+            snap_c = c;
+            continue;
+        }
+
+        // bisect from the last match: keep whichever half still diverges
+        instr -= count;
+        int len = count;
+        while (len > 1) {
+            int half = len / 2;
+            cursor hc = snap_c;
+            if (!replay(ref, test, ref_snap, test_snap, candidate, &hc, half)) {
+                len = half;
+                continue;
+            }
+            chip8 ref_mid = clone_emulator(ref);
+            chip8 test_mid = clone_emulator(test);
+            cursor mid_c = hc;
+            bool split = !replay(ref, test, ref_mid, test_mid, candidate, &hc, len - half);
+            if (split) {
+                copy_emulator(ref_snap, ref_mid);
+                copy_emulator(test_snap, test_mid);
+                snap_c = mid_c;
+                instr += half;
+                len -= half;
+            }
+            destroy_emulator(ref_mid);
+            destroy_emulator(test_mid);
+            if (!split) {
+                // only diverges when the whole window runs as one budget
+                break;
+            }
+        }
+        uint16_t pc = get_pc(ref_snap);
+        uint16_t op = get_ram(ref_snap, pc) << 8 | get_ram(ref_snap, pc + 1);
+        c = snap_c;
+        replay(ref, test, ref_snap, test_snap, candidate, &c, len);
+        instr += len;
+        if (len == 1) {
+            printf("opcode %04X at PC %04X\n", op, pc);
+        } else {
+            printf("opcode %04X at PC %04X starts %d instructions that only diverge run together\n",
+                   op, pc, len);
+        }
+        report(ref, test, candidate->name, instr, &c);
+        status = EXIT_FAILURE;
+        break;
+    }
+
+    if (status == EXIT_SUCCESS) {
+        printf("%s matches reference for %llu instructions\n", candidate->name,
+               (unsigned long long)instr);
+    }
+
+    destroy_emulator(ref_snap);
+    destroy_emulator(test_snap);
+    destroy_emulator(ref);
+    destroy_emulator(test);
+    free_script(&inputs);
+    return status;
+}
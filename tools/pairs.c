@@ -0,0 +1,174 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../include/chip8.h"
+#include "../include/helpers.h"
+#include "../include/script.h"
+
+// Opcode sequence histogram: runs ROMs headlessly on the reference
+// interpreter and counts which instruction forms execute back to back, as
+// pairs and triples. This is the profile the fused interpreter's
+// superinstructions were picked from (see src/interp.inc).
+
+#define NUM_FORMS 64
+#define MAX_SHOWN 20
+
+static void usage(const char* prog) {
+    printf("Usage: %s [-f frames] [-n top] [-s seed] [-i inputs] rom...\n", prog);
+}
+
+// Instruction form: the opcode with its operands masked off.
+static int form(uint16_t op) {
+    switch (op >> 12) {
+        case 0x0:
+            if (op == 0x00E0) return 0;
+            if (op == 0x00EE) return 1;
+            return 2;
+        case 0x5: return 3 + ((op & 0xF) != 0);
+        case 0x8: return 5 + (op & 0xF);
+        case 0xE: return 21 + ((op & 0xFF) == 0xA1);
+        case 0xF:
+            switch (op & 0xFF) {
+                case 0x07: return 23;
+                case 0x0A: return 24;
+                case 0x15: return 25;
+                case 0x18: return 26;
+                case 0x1E: return 27;
+                case 0x29: return 28;
+                case 0x33: return 29;
+                case 0x55: return 30;
+                case 0x65: return 31;
+                default: return 32;
+            }
+        default:
+            return 32 + (op >> 12);
+    }
+}
+
+static const char* FORM_NAMES[NUM_FORMS] = {
+    "00E0", "00EE", "0NNN", "5XY0", "5XYN",
+    "8XY0", "8XY1", "8XY2", "8XY3", "8XY4", "8XY5", "8XY6", "8XY7",
+    "8XY8", "8XY9", "8XYA", "8XYB", "8XYC", "8XYD", "8XYE", "8XYF",
+    "EX9E", "EXA1",
+    "FX07", "FX0A", "FX15", "FX18", "FX1E", "FX29", "FX33", "FX55", "FX65", "FXNN",
+    "1NNN", "2NNN", "3XNN", "4XNN", NULL, "6XNN", "7XNN", NULL, "9XY0",
+    "ANNN", "BNNN", "CXNN", "DXYN",
+};
+
+typedef struct {
+    uint64_t count;
+    int forms[3];
+} sequence;
+
+static int by_count(const void* a, const void* b) {
+    uint64_t ca = ((const sequence*)a)->count;
+    uint64_t cb = ((const sequence*)b)->count;
+    return ca < cb ? 1 : ca > cb ? -1 : 0;
+}
+
+static void print_top(const char* title, uint64_t* counts, int len, uint64_t total, int top) {
+    int n = 1;
+    for (int i = 0; i < len; i++) {
+        n *= NUM_FORMS;
+    }
+    sequence* seqs = malloc((size_t)n * sizeof(sequence));
+    if (!seqs) {
+        fprintf(stderr, "Failed to allocate memory for histogram\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < n; i++) {
+        seqs[i].count = counts[i];
+        for (int k = 0, rest = i; k < len; k++, rest /= NUM_FORMS) {
+            seqs[i].forms[len - 1 - k] = rest % NUM_FORMS;
+        }
+    }
+    qsort(seqs, (size_t)n, sizeof(sequence), by_count);
+
+    printf("%s:\n", title);
+    for (int i = 0; i < top && i < n && seqs[i].count; i++) {
+        printf("  %5.1f%%  %10llu ", total ? 100.0 * seqs[i].count / total : 0.0,
+               (unsigned long long)seqs[i].count);
+        for (int k = 0; k < len; k++) {
+            printf(" %s", FORM_NAMES[seqs[i].forms[k]] ? FORM_NAMES[seqs[i].forms[k]] : "?");
+        }
+        printf("\n");
+    }
+    free(seqs);
+}
+
+int main(int argc, char* argv[]) {
+    int frames = 600;
+    int top = MAX_SHOWN;
+    uint32_t seed = 0xC8C8C8C8;
+    input_script inputs = { NULL, 0 };
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:n:s:i:")) != -1) {
+        switch (opt) {
+            case 'f': frames = atoi(optarg); break;
+            case 'n': top = atoi(optarg); break;
+            case 's': seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'i':
+                if (load_script(optarg, &inputs) != 0) {
+                    return EXIT_FAILURE;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (argc == optind) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t* pairs = calloc(NUM_FORMS * NUM_FORMS, sizeof(uint64_t));
+    uint64_t* triples = calloc(NUM_FORMS * NUM_FORMS * NUM_FORMS, sizeof(uint64_t));
+    if (!pairs || !triples) {
+        fprintf(stderr, "Failed to allocate memory for histogram\n");
+        return EXIT_FAILURE;
+    }
+    uint64_t total = 0;
+
+    for (int r = optind; r < argc; r++) {
+        chip8 emu = init_emulator();
+        set_rng(emu, seed);
+        if (load_rom(emu, argv[r]) != 0) {
+            destroy_emulator(emu);
+            continue;
+        }
+        int prev[2] = { -1, -1 };
+        int next = 0;
+        for (int frame = 0; frame < frames; frame++) {
+            next = apply_script(emu, &inputs, next, frame);
+            for (int i = 0; i < TICKS_PER_FRAME; i++) {
+                uint16_t pc = get_pc(emu);
+                int f = form(get_ram(emu, pc) << 8 | get_ram(emu, (uint16_t)(pc + 1)));
+                tick(emu);
+                if (prev[1] >= 0) {
+                    pairs[prev[1] * NUM_FORMS + f]++;
+                }
+                if (prev[0] >= 0) {
+                    triples[(prev[0] * NUM_FORMS + prev[1]) * NUM_FORMS + f]++;
+                }
+                prev[0] = prev[1];
+                prev[1] = f;
+                total++;
+            }
+            tick_timer(emu);
+        }
+        destroy_emulator(emu);
+    }
+
+    printf("%llu instructions\n", (unsigned long long)total);
+    print_top("pairs", pairs, 2, total, top);
+    print_top("triples", triples, 3, total, top);
+    free(pairs);
+    free(triples);
+    free_script(&inputs);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/shm.h"
+
+// Example shared-memory reader: prints the live screen of an emulator
+// started with --shm NAME as text whenever a new frame is published.
+
+static void usage(const char* prog) {
+    printf("Usage: %s [-n frames] name\n", prog);
+}
+
+int main(int argc, char* argv[]) {
+    long limit = -1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+            case 'n': limit = atol(optarg); break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind != 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    struct shared_frame* shared = map_shared_frame(argv[optind]);
+    if (!shared) {
+        return EXIT_FAILURE;
+    }
+
+    struct shared_frame frame;
+    uint64_t last = UINT64_MAX;
+    struct timespec nap = { 0, 2000000 };
+    while (limit != 0) {
+        read_shared_frame(shared, &frame);
+        if (frame.frame == last) {
+            nanosleep(&nap, NULL);
+            continue;
+        }
+        last = frame.frame;
+        printf("\033[H\033[2Jframe %llu keys %04X\n", (unsigned long long)frame.frame, frame.keys);
+        // one character per pixel: plane 1, plane 2, both
+        static const char shades[] = " #+@";
+        for (int y = 0; y < frame.height && y < HIRES_HEIGHT; y++) {
+            char line[HIRES_WIDTH + 1];
+            int x = 0;
+            for (; x < frame.width && x < HIRES_WIDTH; x++) {
+                int bit = 63 - x % 64;
+                int p1 = (frame.rows[0][y][x / 64] >> bit) & 1;
+                int p2 = (frame.rows[1][y][x / 64] >> bit) & 1;
+                line[x] = shades[p1 | p2 << 1];
+            }
+            line[x] = '\0';
+            printf("%s\n", line);
+        }
+        fflush(stdout);
+        if (limit > 0) {
+            limit--;
+        }
+    }
+
+    unmap_shared_frame(shared);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,125 @@
+#define _POSIX_C_SOURCE 200809L
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/chip8.h"
+#include "../include/helpers.h"
+#include "../include/metrics.h"
+#include "../include/stream.h"
+
+// Headless streaming server: runs a ROM at 60 frames per second and serves
+// its screen to viewers, taking their key events as input.
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static void usage(const char* prog) {
+    printf("Usage: %s [-l unix:/path|[host:]port] [-s seed] [-m unix:/path|[host:]port] [-j stats.json] rom\n", prog);
+}
+
+int main(int argc, char* argv[]) {
+    const char* addr = "unix:/tmp/chip8.sock";
+    uint32_t seed = 0;
+    const char* metrics_addr = NULL;
+    const char* metrics_json = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "l:s:m:j:")) != -1) {
+        switch (opt) {
+            case 'l': addr = optarg; break;
+            case 's': seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'm': metrics_addr = optarg; break;
+            case 'j': metrics_json = optarg; break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind != 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    chip8 emu = init_emulator();
+    if (seed) {
+        set_rng(emu, seed);
+    }
+    if (load_rom(emu, argv[optind]) != 0) {
+        destroy_emulator(emu);
+        return EXIT_FAILURE;
+    }
+
+    stream_server server = create_stream_server(addr);
+    if (!server) {
+        destroy_emulator(emu);
+        return EXIT_FAILURE;
+    }
+    metrics stats = NULL;
+    metrics_server stats_server = NULL;
+    if (metrics_addr || metrics_json) {
+        stats = create_metrics("streamd");
+        set_metrics_dump(stats, metrics_json);
+    }
+    if (metrics_addr) {
+        stats_server = create_metrics_server(metrics_addr);
+        if (!stats_server) {
+            destroy_metrics(stats);
+            destroy_stream_server(server);
+            destroy_emulator(emu);
+            return EXIT_FAILURE;
+        }
+        register_metrics(stats_server, stats);
+    }
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    printf("serving %s on %s\n", argv[optind], addr);
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    uint32_t frame = 0;
+    while (running) {
+        stream_poll(server, emu);
+        if (stats_server) {
+            metrics_serve(stats_server);
+        }
+        if (stats) {
+            metrics_mark(stats, PHASE_POLL);
+        }
+        run_frame(emu);
+        if (stats) {
+            metrics_mark(stats, PHASE_TICK);
+        }
+        stream_frame(server, emu, frame++);
+        if (stats) {
+            metrics_mark(stats, PHASE_DRAW);
+        }
+
+        next.tv_nsec += 1000000000L / 60;
+        if (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        if (stats) {
+            metrics_mark(stats, PHASE_IDLE);
+            metrics_frame(stats, emu);
+        }
+    }
+
+    if (stats_server) {
+        destroy_metrics_server(stats_server);
+    }
+    if (stats) {
+        destroy_metrics(stats);
+    }
+    destroy_stream_server(server);
+    destroy_emulator(emu);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+#define _POSIX_C_SOURCE 200809L
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include "../include/stream.h"
+
+// Minimal stream viewer: draws the remote screen in the terminal and sends
+// keys typed on the same layout as the SDL frontend (1234/qwer/asdf/zxcv).
+// Terminals report no key releases, so each key is released again after
+// RELEASE_FRAMES frames. With -q nothing is drawn and only the bandwidth is
+// reported, which is how the loopback test uses it.
+
+#define RELEASE_FRAMES 6
+
+static const char KEYMAP[NUM_KEYS] = {
+    'x', '1', '2', '3', 'q', 'w', 'e', 'a', 's', 'd', 'z', 'c', '4', 'r', 'f', 'v',
+};
+
+static void usage(const char* prog) {
+    printf("Usage: %s [-q] [-n frames] unix:/path|[host:]port\n", prog);
+}
+
+static void draw(const packed_screen* screen, uint32_t frame, long bytes) {
+    // one character per pixel: plane 1, plane 2, both
+    static const char shades[] = " #+@";
+    printf("\033[H\033[2Jframe %u, %ld bytes received\n", frame, bytes);
+    for (int y = 0; y < PACKED_HEIGHT(screen); y++) {
+        char line[HIRES_WIDTH + 1];
+        int x = 0;
+        for (; x < PACKED_WIDTH(screen); x++) {
+            int bit = 63 - x % 64;
+            int p1 = (screen->rows[0][y][x / 64] >> bit) & 1;
+            int p2 = (screen->rows[1][y][x / 64] >> bit) & 1;
+            line[x] = shades[p1 | p2 << 1];
+        }
+        line[x] = '\0';
+        printf("%s\n", line);
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+    bool quiet = false;
+    long limit = -1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "qn:")) != -1) {
+        switch (opt) {
+            case 'q': quiet = true; break;
+            case 'n': limit = atol(optarg); break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind != 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    stream_client client = connect_stream(argv[optind]);
+    if (!client) {
+        return EXIT_FAILURE;
+    }
+
+    struct termios saved;
+    bool raw = !quiet && isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &saved) == 0;
+    if (raw) {
+        struct termios t = saved;
+        t.c_lflag &= ~(ICANON | ECHO);
+        tcsetattr(STDIN_FILENO, TCSANOW, &t);
+    }
+
+    packed_screen screen;
+    memset(&screen, 0, sizeof(screen));
+    int held[NUM_KEYS];
+    memset(held, 0, sizeof(held));
+    long frames = 0;
+    long bytes = 0;
+    uint32_t frame = 0;
+
+    struct pollfd fds[2] = {
+        { stream_client_fd(client), POLLIN, 0 },
+        { STDIN_FILENO, POLLIN, 0 },
+    };
+    while (limit < 0 || frames < limit) {
+        if (poll(fds, raw ? 2 : 1, -1) < 0) {
+            break;
+        }
+        if (raw && (fds[1].revents & POLLIN)) {
+            char c;
+            if (read(STDIN_FILENO, &c, 1) == 1) {
+                for (int k = 0; k < NUM_KEYS; k++) {
+                    if (KEYMAP[k] == c) {
+                        stream_send_key(client, (uint8_t)k, true);
+                        held[k] = RELEASE_FRAMES;
+                    }
+                }
+            }
+        }
+        if (!(fds[0].revents & (POLLIN | POLLHUP))) {
+            continue;
+        }
+
+        int n = stream_receive(client, &screen, &frame);
+        if (n < 0) {
+            break;
+        }
+        bytes += n;
+        frames++;
+        for (int k = 0; k < NUM_KEYS; k++) {
+            if (held[k] && --held[k] == 0) {
+                stream_send_key(client, (uint8_t)k, false);
+            }
+        }
+        if (!quiet) {
+            draw(&screen, frame, bytes);
+        }
+    }
+
+    if (raw) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+    }
+    printf("%ld frames, %ld bytes, %.1f bytes/frame\n", frames, bytes,
+           frames ? (double)bytes / frames : 0.0);
+    destroy_stream_client(client);
+    return EXIT_SUCCESS;
+}